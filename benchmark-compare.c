@@ -0,0 +1,513 @@
+/** *******************************************************************************
+ * @remark program compares result files of the benchmark harness,                *
+ *         flagging algorithms whose times changed significantly                  *
+ *                                                                                *
+ * @remark usage:  benchmark-compare [--threshold=2] [--absolute] old new         *
+ *         or      benchmark-compare [options] old1 old2 ... -- new1 new2 ...     *
+ *         either file may hold JSON lines (--jsonl) or CSV rows (--csv), as      *
+ *         written by sort-comparisons, partition and the other drivers           *
+ *                                                                                *
+ * @remark a row of the old file and one of the new match when they have the      *
+ *         same program, algorithm, data set and size.  The mean wall times are   *
+ *         compared with Welch's t test, from the mean, standard deviation and    *
+ *         number of runs kept after outlier rejection.  A change is flagged      *
+ *         when the test is significant at the 95% level, the means differ by     *
+ *         more than the threshold percentage, and the difference is larger       *
+ *         than the spread from the fastest run to the 95th percentile of each    *
+ *         file.  Operation counts, when both files have them, must match         *
+ *         exactly                                                                *
+ *                                                                                *
+ * @remark the t test sees only the variation among the runs of one program       *
+ *         invocation.  Two invocations differ by more than that, through         *
+ *         frequency scaling, memory placement and other load, so the test        *
+ *         alone flags many changes between two runs of the same binary.  Much    *
+ *         of that difference slows or speeds every algorithm alike, so unless    *
+ *         --absolute is given, each old time is first scaled by the median       *
+ *         ratio of new to old times over all matched rows, and only changes      *
+ *         beyond that shift of the whole machine are judged; the shift itself    *
+ *         is printed.  What remains of the variation between invocations is      *
+ *         measured only when a side has several files, one per invocation:       *
+ *         then each row's mean and standard deviation are those of the           *
+ *         invocations' means, and the t test judges a change against them.       *
+ *         With one file a side, changes are marked unconfirmed and do not        *
+ *         count toward the exit status.  Use --absolute when every algorithm     *
+ *         may have changed, as with a new compiler                               *
+ *                                                                                *
+ * @remark the Old (ms) column shows the old mean as scaled by the machine's      *
+ *         shift, the time the change is measured against                         *
+ *                                                                                *
+ * @remark rows of a pair whose host, processor or compiler differ are marked,    *
+ *         as their change need not come from the code                            *
+ *                                                                                *
+ * @remark exit status: 0 with no regression, 1 with at least one confirmed by    *
+ *         two or more files a side, 2 if a file cannot be read, so a build can   *
+ *         be gated on the comparison                                             *
+ *                                                                                *
+ * @file  benchmark-compare.c                                                     *
+ *                                                                                *
+ * @remark compile with:  gcc -O2 benchmark-compare.c -o benchmark-compare        *
+ *                                                                                *
+ *********************************************************************************/
+
+#include <stdio.h>
+#include <stdbool.h>  // for bool
+#include <stdlib.h>   // for malloc, realloc, free, strtod
+#include <string.h>   // for strstr, strcmp, strncmp
+
+#include "benchmark.h" // for the field names, benchSqrt and benchStudentT
+
+#define maxLine 4096   // longest line of a result file
+#define minRowsToShift 8 // fewest matched rows from which to estimate the machine's shift
+
+/** *******************************************************************************
+ * the fields of one result row that the comparison uses                          *
+ *********************************************************************************/
+typedef struct result {
+    char program [64];
+    char algorithm [40];
+    char shape [40];
+    long long n;
+    int kept;                    /**< runs kept after outlier rejection          */
+    double min;                  /**< fastest wall time kept, in ms              */
+    double p95;                  /**< 95th percentile wall time kept, in ms      */
+    double mean;                 /**< mean wall time, in ms                      */
+    double stddev;               /**< standard deviation of the wall times       */
+    double ops [benchNumOps];    /**< operations per element; -1 when missing    */
+    char host [64];
+    char cpu [benchFieldLength];
+    char compiler [80];
+    bool matched;                /**< whether a row of the other file matched    */
+    struct result * partner;     /**< the matching row of the old file, or NULL  */
+} result;
+
+/** *******************************************************************************
+ * the rows of one result file                                                    *
+ *********************************************************************************/
+typedef struct resultFile {
+    result * rows;
+    int count;
+    int capacity;
+} resultFile;
+
+/* * * * * * * * * * * * * * * * * reading rows * * * * * * * * * * * * * * * * * */
+
+/* set field to the text of a JSON value or CSV field, dropping quotes and escapes */
+void copyValue (char field [ ], int size, char * value, char * end) {
+    int k = 0;
+    if (*value == '"')
+        value++;
+    for (; value < end && *value != '"' && k < size - 1; value++) {
+        if (*value == '\\' && value + 1 < end)
+            value++;
+        field[k++] = *value;
+    }
+    field[k] = '\0';
+}
+
+/** *******************************************************************************
+ * find the value of a key in a JSON line of the harness's flat records           *
+ * @param  line  the JSON line                                                    *
+ * @param  key   the field name                                                   *
+ * @param  field  receives the text of the value, without quotes; null is empty   *
+ * @param  size  room in field                                                    *
+ *********************************************************************************/
+void jsonValue (char * line, char * key, char field [ ], int size) {
+    char pattern [64];
+    snprintf (pattern, sizeof(pattern), "\"%s\":", key);
+    field[0] = '\0';
+    char * value = strstr (line, pattern);
+    if (value == NULL)
+        return;
+    value += strlen (pattern);
+    while (*value == ' ')
+        value++;
+
+    char * end = value;
+    if (*value == '"') {
+        for (end = value + 1; *end != '\0' && *end != '"'; end++) {
+            if (*end == '\\' && end[1] != '\0')
+                end++;
+        }
+    } else {
+        end = value + strcspn (value, ",}");
+        if (strncmp (value, "null", 4) == 0)
+            return;
+    }
+    copyValue (field, size, value, end);
+}
+
+/** *******************************************************************************
+ * split a CSV row into fields, in place                                          *
+ * @param  line  the row; separators and quotes are overwritten                   *
+ * @param  fields  receives the start of each field                               *
+ * @param  max  room in fields                                                    *
+ * @returns  the number of fields                                                 *
+ *********************************************************************************/
+int splitCsv (char * line, char * fields [ ], int max) {
+    int count = 0;
+    char * c = line;
+    while (count < max) {
+        char * out = c;
+        fields[count++] = out;
+        if (*c == '"') {
+            // quoted field: "" stands for one quote
+            c++;
+            while (*c != '\0' && !(*c == '"' && c[1] != '"')) {
+                if (*c == '"')
+                    c++;
+                *out++ = *c++;
+            }
+            if (*c == '"')
+                c++;
+        } else {
+            while (*c != '\0' && *c != ',' && *c != '\n' && *c != '\r')
+                *out++ = *c++;
+        }
+        bool more = (*c == ',');
+        *out = '\0';
+        if (!more)
+            break;
+        c++;
+    }
+    return count;
+}
+
+/* value of a number field, or missing if the field is empty */
+double numberOr (char * field, double missing) {
+    return (field[0] != '\0') ? strtod (field, NULL) : missing;
+}
+
+/* add a row to a file's rows, given the text of each of its fields */
+void addRow (resultFile * file, char fields [ ][benchFieldLength]) {
+    if (file->count == file->capacity) {
+        file->capacity = (file->capacity > 0) ? 2 * file->capacity : 64;
+        file->rows = (result *) realloc (file->rows, file->capacity * sizeof(result));
+    }
+    result * row = &file->rows[file->count++];
+    snprintf (row->program, sizeof(row->program), "%s", fields[0]);
+    snprintf (row->algorithm, sizeof(row->algorithm), "%s", fields[1]);
+    snprintf (row->shape, sizeof(row->shape), "%s", fields[2]);
+    row->n = atoll (fields[3]);
+    row->kept = atoi (fields[5]) - atoi (fields[6]);
+    row->min = numberOr (fields[7], 0);
+    row->p95 = numberOr (fields[9], 0);
+    row->mean = numberOr (fields[10], 0);
+    row->stddev = numberOr (fields[11], 0);
+    for (int op = 0; op < benchNumOps; op++)
+        row->ops[op] = numberOr (fields[18 + op], -1);
+    snprintf (row->host, sizeof(row->host), "%s", fields[23]);
+    snprintf (row->cpu, sizeof(row->cpu), "%s", fields[24]);
+    snprintf (row->compiler, sizeof(row->compiler), "%.79s", fields[26]);
+    row->matched = false;
+    row->partner = NULL;
+}
+
+/** *******************************************************************************
+ * read a result file of JSON lines or CSV rows, telling them apart by the        *
+ * first character of the first line                                              *
+ * @param  name  the name of the file                                             *
+ * @param  file  receives the rows, after those it already holds                  *
+ * @returns  0, or -1 after printing a message if the file cannot be read         *
+ *********************************************************************************/
+int readResults (char * name, resultFile * file) {
+    FILE * in = fopen (name, "r");
+    if (in == NULL) {
+        printf ("cannot read %s\n", name);
+        return -1;
+    }
+
+    static char line [maxLine];
+    static char fields [benchNumFields][benchFieldLength];
+    int column [benchNumFields];   // CSV column of each field, or -1
+    bool csv = false;
+    bool first = true;
+    while (fgets (line, sizeof(line), in) != NULL) {
+        if (first) {
+            first = false;
+            if (line[0] != '{') {
+                // the CSV heading gives the column of each field
+                csv = true;
+                char * heading [benchNumFields * 2];
+                int num = splitCsv (line, heading, benchNumFields * 2);
+                for (int f = 0; f < benchNumFields; f++) {
+                    column[f] = -1;
+                    for (int c = 0; c < num; c++)
+                        if (strcmp (heading[c], benchFieldNames[f]) == 0)
+                            column[f] = c;
+                }
+                continue;
+            }
+        }
+
+        if (csv) {
+            char * values [benchNumFields * 2];
+            int num = splitCsv (line, values, benchNumFields * 2);
+            for (int f = 0; f < benchNumFields; f++) {
+                char * value = (column[f] >= 0 && column[f] < num) ? values[column[f]] : "";
+                snprintf (fields[f], benchFieldLength, "%s", value);
+            }
+        } else {
+            if (line[0] != '{')
+                continue;
+            for (int f = 0; f < benchNumFields; f++)
+                jsonValue (line, benchFieldNames[f], fields[f], benchFieldLength);
+        }
+        if (fields[1][0] != '\0')
+            addRow (file, fields);
+    }
+    fclose (in);
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * * the comparison * * * * * * * * * * * * * * * * */
+
+/* whether two rows have the same program, algorithm, data set and size */
+bool sameKey (result * a, result * b) {
+    return a->n == b->n && strcmp (a->program, b->program) == 0
+           && strcmp (a->algorithm, b->algorithm) == 0 && strcmp (a->shape, b->shape) == 0;
+}
+
+/* the first unmatched row of file with the same key as row, or NULL */
+result * findMatch (resultFile * file, result * row) {
+    for (int i = 0; i < file->count; i++) {
+        result * other = &file->rows[i];
+        if (!other->matched && sameKey (other, row))
+            return other;
+    }
+    return NULL;
+}
+
+/** *******************************************************************************
+ * combine the rows of several invocations of the same benchmark into one row     *
+ * per key, whose mean and standard deviation are those of the invocations'       *
+ * means, so the comparison judges a change against the variation between         *
+ * invocations rather than within one                                             *
+ * @param  file     the rows of all the invocations, replaced by the combination  *
+ *********************************************************************************/
+void combineInvocations (resultFile * file) {
+    int count = 0;
+    for (int i = 0; i < file->count; i++) {
+        result * first = &file->rows[i];
+        if (first->matched)
+            continue;
+        result combined = *first;
+        double sum = 0, squares = 0;
+        int num = 0;
+        for (int j = i; j < file->count; j++) {
+            result * row = &file->rows[j];
+            if (row->matched || !sameKey (row, first))
+                continue;
+            row->matched = true;
+            sum += row->mean;
+            squares += row->mean * row->mean;
+            if (row->min < combined.min)
+                combined.min = row->min;
+            if (row->p95 > combined.p95)
+                combined.p95 = row->p95;
+            num++;
+        }
+        combined.kept = num;
+        combined.mean = sum / num;
+        double variance = (num > 1) ? (squares - sum * sum / num) / (num - 1) : 0;
+        combined.stddev = (variance > 0) ? benchSqrt (variance) : 0;
+        combined.matched = false;
+        file->rows[count++] = combined;
+    }
+    file->count = count;
+}
+
+/** *******************************************************************************
+ * Welch's t statistic for the difference of two means, new minus old             *
+ * @param  df  set to the Welch-Satterthwaite degrees of freedom                  *
+ * @returns  the t statistic, 0 if either side has fewer than two runs            *
+ *********************************************************************************/
+double welchT (result * old, result * new, double * df) {
+    *df = 0;
+    if (old->kept < 2 || new->kept < 2)
+        return 0;
+    double varOld = old->stddev * old->stddev / old->kept;
+    double varNew = new->stddev * new->stddev / new->kept;
+    double se = benchSqrt (varOld + varNew);
+    if (se == 0)
+        return 0;
+    *df = (varOld + varNew) * (varOld + varNew)
+          / (varOld * varOld / (old->kept - 1) + varNew * varNew / (new->kept - 1));
+    return (new->mean - old->mean) / se;
+}
+
+/** *******************************************************************************
+ * the shift of the whole machine between two result files: the median ratio of   *
+ * the new mean to the old over the matched rows, or 1 with too few of them       *
+ *********************************************************************************/
+double machineShift (resultFile * new) {
+    double * ratios = (double *) malloc ((new->count + 1) * sizeof(double));
+    int num = 0;
+    for (int i = 0; i < new->count; i++) {
+        result * row = &new->rows[i];
+        if (row->partner != NULL && row->partner->mean > 0 && row->mean > 0)
+            ratios[num++] = row->mean / row->partner->mean;
+    }
+    double shift = 1;
+    if (num >= minRowsToShift) {
+        qsort (ratios, num, sizeof(double), benchCompareDoubles);
+        shift = benchQuantile (ratios, num, 0.5);
+    }
+    free (ratios);
+    return shift;
+}
+
+/** *******************************************************************************
+ * compare two result files, printing one line per matched row                    *
+ *********************************************************************************/
+int main (int argc, char * argv [ ]) {
+    double threshold = 2;   // percent change below which nothing is flagged
+    bool absolute = false;  // whether to leave the machine's shift in the changes
+    char * names [argc];
+    int numNames = 0;
+    int numOld = -1;        // names before the --, if any
+    bool understood = true;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp (argv[i], "--threshold=", 12) == 0)
+            threshold = atof (argv[i] + 12);
+        else if (strcmp (argv[i], "--absolute") == 0)
+            absolute = true;
+        else if (strcmp (argv[i], "--") == 0 && numOld < 0)
+            numOld = numNames;
+        else if (strncmp (argv[i], "--", 2) != 0)
+            names[numNames++] = argv[i];
+        else
+            understood = false;
+    }
+    if (numOld < 0 && numNames == 2)
+        numOld = 1;
+    if (!understood || numOld < 1 || numNames - numOld < 1) {
+        printf ("usage:  %s [--threshold=percent] [--absolute] old-results new-results\n"
+                "        %s [--threshold=percent] [--absolute] old-results... -- "
+                "new-results...\n"
+                "changes fail the comparison only with two or more files a side, one per "
+                "invocation\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    resultFile old = {NULL, 0, 0}, new = {NULL, 0, 0};
+    for (int f = 0; f < numNames; f++) {
+        if (readResults (names[f], (f < numOld) ? &old : &new) < 0)
+            return 2;
+    }
+    if (numOld > 1)
+        combineInvocations (&old);
+    if (numNames - numOld > 1)
+        combineInvocations (&new);
+
+    int unmatched = 0;
+    for (int i = 0; i < new.count; i++) {
+        result * row = &new.rows[i];
+        row->partner = findMatch (&old, row);
+        if (row->partner != NULL)
+            row->partner->matched = true;
+        else
+            unmatched++;
+    }
+    for (int i = 0; i < old.count; i++)
+        if (!old.rows[i].matched)
+            unmatched++;
+
+    double shift = machineShift (&new);
+    if (shift != 1)
+        printf ("the new file runs %.2lf%% %s overall; %s\n\n",
+                (shift > 1) ? (shift - 1) * 100 : (1 - shift) * 100,
+                (shift > 1) ? "slower" : "faster",
+                absolute ? "changes are measured without allowing for that"
+                         : "old times are scaled by that before comparing");
+    if (absolute)
+        shift = 1;
+
+    printf ("%-22s %-22s %-13s %9s %12s %12s %8s %7s  %s\n", "Program", "Algorithm",
+            "Data Set", "Size", "Old (ms)", "New (ms)", "Change %", "t", "Verdict");
+
+    // with one file a side the test cannot see the variation between invocations,
+    // so its changes are reported but do not fail the comparison
+    bool confirmed = numOld > 1 && numNames - numOld > 1;
+    int slower = 0, faster = 0, unconfirmed = 0, opsChanged = 0, otherSetup = 0;
+    for (int i = 0; i < new.count; i++) {
+        result * row = &new.rows[i];
+        result * before = row->partner;
+        if (before == NULL)
+            continue;
+
+        // the old row as the new machine would have timed it
+        result expected = *before;
+        expected.min *= shift;
+        expected.p95 *= shift;
+        expected.mean *= shift;
+        expected.stddev *= shift;
+
+        double change = (expected.mean > 0) ? (row->mean - expected.mean) / expected.mean * 100
+                                            : 0;
+        double df;
+        double t = welchT (&expected, row, &df);
+        bool significant;
+        if (before->kept < 2 || row->kept < 2)
+            significant = false;
+        else if (df > 0)
+            significant = t > benchStudentT ((int) df) || t < -benchStudentT ((int) df);
+        else   // neither side varies, so any difference is real
+            significant = row->mean != expected.mean;
+
+        // a real change also moves the mean further than the spreads of the runs of
+        // both files, from the fastest to the 95th percentile, added together
+        double difference = (row->mean > expected.mean) ? row->mean - expected.mean
+                                                         : expected.mean - row->mean;
+        bool beyondSpread = difference > (expected.p95 - expected.min) + (row->p95 - row->min);
+        char * verdict = "same";
+        if (significant && beyondSpread && change > threshold) {
+            verdict = confirmed ? "SLOWER" : "slower, unconfirmed";
+            if (confirmed)
+                slower++;
+            else
+                unconfirmed++;
+        } else if (significant && beyondSpread && change < -threshold) {
+            verdict = confirmed ? "faster" : "faster, unconfirmed";
+            if (confirmed)
+                faster++;
+            else
+                unconfirmed++;
+        } else if (before->kept < 2 || row->kept < 2)
+            verdict = "too few runs";
+        else if (significant && (change > threshold || change < -threshold))
+            verdict = "within spread";
+
+        bool sameSetup = strcmp (before->host, row->host) == 0
+                         && strcmp (before->cpu, row->cpu) == 0
+                         && strcmp (before->compiler, row->compiler) == 0;
+        if (!sameSetup)
+            otherSetup++;
+
+        bool opsDiffer = false;
+        for (int op = 0; op < benchNumOps; op++) {
+            if (before->ops[op] >= 0 && row->ops[op] >= 0 && before->ops[op] != row->ops[op])
+                opsDiffer = true;
+        }
+        if (opsDiffer)
+            opsChanged++;
+
+        printf ("%-22s %-22s %-13s %9lld %12.3lf %12.3lf %8.2lf %7.2lf  %s%s%s\n",
+                row->program, row->algorithm, row->shape, row->n, expected.mean, row->mean,
+                change, t, verdict, opsDiffer ? ", operation counts changed" : "",
+                sameSetup ? "" : ", other machine or compiler");
+    }
+
+    printf ("\n%d slower, %d faster, %d with changed operation counts, %d rows unmatched\n",
+            slower, faster, opsChanged, unmatched);
+    if (unconfirmed > 0)
+        printf ("%d unconfirmed changes, as a file from one invocation a side cannot tell "
+                "them from noise;\ncompare two or more files a side to confirm them\n",
+                unconfirmed);
+    if (otherSetup > 0)
+        printf ("warning:  %d matched rows come from a different host, processor or "
+                "compiler\n", otherSetup);
+
+    free (old.rows);
+    free (new.rows);
+    return (slower > 0) ? 1 : 0;
+}
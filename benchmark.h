@@ -0,0 +1,1085 @@
+/** *******************************************************************************
+ * @remark shared benchmark harness for the sorting and partition programs        *
+ *                                                                                *
+ * @remark each program registers its algorithms, then hands its command line to  *
+ *         benchRun, which generates the data sets, times every algorithm on      *
+ *         copies of identical data, checks the results and prints a table.       *
+ *         Data comes from a seeded generator, not rand(), so two programs run    *
+ *         with the same seed time their algorithms on exactly the same data      *
+ *                                                                                *
+ * @remark usage, in a program's main:                                            *
+ *         benchInit (10000, 160000, 2);                                          *
+ *         benchAddSort ("merge sort", mergeSort);                                *
+ *         benchAddRange ("merge sort recursive", mergeSortRecursive);            *
+ *         benchAddPartition ("invariant 1a", invariant1a);                       *
+ *         return benchRun (argc, argv);                                          *
+ *                                                                                *
+ * @remark command line options, all optional:                                    *
+ *         --algs=merge,heap     only algorithms whose names contain a pattern    *
+ *         --shapes=random       only data sets whose names contain a pattern     *
+ *         --sizes=10000:80000   smallest and largest data set sizes              *
+ *         --trials=5            fewest timed runs per algorithm and data set     *
+ *         --max-trials=100      most timed runs per algorithm and data set       *
+ *         --ci=2                stop once the 95% confidence interval of the     *
+ *                               mean is within this many percent of it           *
+ *         --time-limit=5        or once this many seconds have been spent        *
+ *         --warmup=1            untimed runs before the timed ones               *
+ *         --seed=415            seed of the data generator                       *
+ *         --perf                add hardware counter columns, on Linux: IPC,     *
+ *                               and branch, L1 data and last-level cache         *
+ *                               misses per element                               *
+ *         --jsonl=results.jsonl also write each row of the table as a JSON line  *
+ *         --csv=results.csv     also write each row of the table as a CSV row    *
+ *                                                                                *
+ * @remark the JSON lines and CSV rows hold the same fields: the program,         *
+ *         algorithm, data set, size and seed, the statistics of the table        *
+ *         with the standard deviation, the counters when measured, the check,    *
+ *         and the host, processor, compiler, system and date of the run.  The    *
+ *         benchmark-compare program compares two such files                      *
+ *                                                                                *
+ * @remark a program compiled with -DcountOperations=1 adds columns of the        *
+ *         comparisons, swaps and writes per run, per element and per n lg n,     *
+ *         for the algorithms it marks as counted                                 *
+ *                                                                                *
+ * @remark each run is timed by the wall clock, CLOCK_MONOTONIC, and by the CPU   *
+ *         time of the calling thread, CLOCK_THREAD_CPUTIME_ID.  Wall times       *
+ *         outside Tukey's fences, more than 1.5 interquartile ranges beyond      *
+ *         the quartiles, are rejected as outliers before the statistics, so a    *
+ *         run interrupted by the system does not skew them                       *
+ *                                                                                *
+ * @file  benchmark.h                                                             *
+ *                                                                                *
+ *********************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdio.h>
+#include <stdlib.h>   // for malloc, free, qsort, atoi
+#include <string.h>   // for strstr, strncmp, memcpy
+#include <time.h>     // for clock_gettime
+
+#ifdef __linux__
+#include <linux/perf_event.h> // for perf_event_attr
+#include <sys/ioctl.h>        // for ioctl
+#include <sys/syscall.h>      // for syscall, __NR_perf_event_open
+#include <unistd.h>           // for read, close, gethostname
+#include <sys/utsname.h>      // for uname
+#endif
+
+#define benchMaxAlgs    64    // most algorithms one program may register
+#define benchMaxShapes   8    // most kinds of data set one program may register
+#define benchMaxTrials 1000   // most timed runs per algorithm and data set
+#define benchOutlierFence 1.5 // outliers lie this many interquartile ranges beyond a quartile
+
+/** *******************************************************************************
+ * a kind of data set: its name and the procedure generating n elements of it     *
+ *********************************************************************************/
+typedef struct benchShape {
+    char * name;
+    void (*fill) (int a [ ], int n, unsigned long long * state);
+} benchShape;
+
+/** *******************************************************************************
+ * a registered algorithm; exactly one of the three procedures is set             *
+ *********************************************************************************/
+typedef struct benchAlg {
+    char name [40];                               /**< name, trailing blanks and colons removed */
+    void (*sortProc) (int [ ], int);              /**< sorts a[0..n-1]                         */
+    void (*rangeProc) (int *, int, int);          /**< sorts a[l..r]                           */
+    int (*partitionProc) (int [ ], int, int, int);/**< partitions a[l..r] about a[l]           */
+    int maxSize [benchMaxShapes];                 /**< largest size per shape; 0 for no limit  */
+    int counted;                                  /**< uses the op macros; 0 until set         */
+} benchAlg;
+
+/** *******************************************************************************
+ * settings of a benchmark run, from the program's defaults and the command line  *
+ *********************************************************************************/
+typedef struct benchConfig {
+    int minSize;                 /**< size of the smallest data set                */
+    int maxSize;                 /**< size of the largest data set                 */
+    int factor;                  /**< each data set is this many times the last    */
+    int trials;                  /**< fewest timed runs per algorithm and data set */
+    int maxTrials;               /**< most timed runs per algorithm and data set   */
+    double targetCI;             /**< relative half-width of the 95% CI to reach   */
+    double timeLimit;            /**< seconds of timed runs after which to stop    */
+    int warmup;                  /**< untimed runs before the timed ones           */
+    unsigned long long seed;     /**< seed of the data generator                   */
+    char * algFilter;            /**< comma-separated name patterns, or NULL       */
+    char * shapeFilter;          /**< comma-separated shape patterns, or NULL      */
+    int perf;                    /**< whether to read hardware counters            */
+    char * jsonFile;             /**< file receiving JSON lines, or NULL           */
+    char * csvFile;              /**< file receiving CSV rows, or NULL             */
+} benchConfig;
+
+benchAlg benchAlgs [benchMaxAlgs];
+int benchNumAlgs = 0;
+benchShape benchShapes [benchMaxShapes];
+int benchNumShapes = 0;
+benchConfig benchConf;
+
+// optional hooks run before each timed call and after the last, so a program
+// can add its own figures to the end of each row of the table
+void (*benchResetHook) (void) = NULL;
+void (*benchNoteHook) (char note [ ], int length) = NULL;
+
+/** *******************************************************************************
+ * statistics of the timed runs of one algorithm on one data set, in seconds      *
+ *********************************************************************************/
+typedef struct benchSummary {
+    int trials;                  /**< timed runs                                  */
+    int outliers;                /**< runs rejected as outliers                   */
+    double min;                  /**< fastest wall time kept                      */
+    double median;               /**< median wall time kept                       */
+    double p95;                  /**< 95th percentile wall time kept              */
+    double mean;                 /**< mean wall time kept                         */
+    double ci;                   /**< half-width of the 95% CI of the mean, as a  */
+                                 /**< fraction of the mean                        */
+    double stddev;               /**< standard deviation of the wall times kept   */
+    double cpuMedian;            /**< median CPU time of the calling thread       */
+} benchSummary;
+
+/* * * * * * * * * * * * * * * * operation counters  * * * * * * * * * * * * * * * */
+
+/** *******************************************************************************
+ * counts of the element comparisons, swaps and writes an algorithm makes         *
+ * @remark  compile with -DcountOperations=1 to count them; otherwise the macros  *
+ *          below reduce to the bare comparison and to nothing, so the timed      *
+ *          code is unchanged.  A swap counts as one swap and two writes; a       *
+ *          write is any store of an element into the array or a buffer.  The     *
+ *          counters are updated atomically, so parallel sorts count correctly,   *
+ *          but counting slows every algorithm and its times are not comparable   *
+ *          with those of an ordinary build.  Only algorithms that use the        *
+ *          macros are counted: a program sets the counted flag of each one it    *
+ *          has instrumented, and the others print --- and write null             *
+ *********************************************************************************/
+#ifndef countOperations
+#define countOperations 0     // 1 counts comparisons, swaps and writes
+#endif
+
+#define benchNumOps 3         // comparisons, swaps, writes
+
+long long benchOps [benchNumOps];
+
+#if countOperations
+#define opCompare(test)  (__atomic_fetch_add (&benchOps[0], 1, __ATOMIC_RELAXED), (test))
+#define opSwap()         (__atomic_fetch_add (&benchOps[1], 1, __ATOMIC_RELAXED),  \
+                          __atomic_fetch_add (&benchOps[2], 2, __ATOMIC_RELAXED))
+#define opCompares(k)    __atomic_fetch_add (&benchOps[0], (k), __ATOMIC_RELAXED)
+#define opWrites(k)      __atomic_fetch_add (&benchOps[2], (k), __ATOMIC_RELAXED)
+#else
+#define opCompare(test)  (test)
+#define opSwap()         ((void) 0)
+#define opCompares(k)    ((void) 0)
+#define opWrites(k)      ((void) 0)
+#endif
+#define opWrite()        opWrites (1)
+
+/* * * * * * * * * * * * * * * * * data generators  * * * * * * * * * * * * * * * */
+
+/** *******************************************************************************
+ * next value of the splitmix64 generator, as a non-negative int like rand()      *
+ *********************************************************************************/
+int benchRandom (unsigned long long * state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (int) ((z ^ (z >> 31)) >> 33);
+}
+
+void benchFillAscending (int a [ ], int n, unsigned long long * state) {
+    (void) state;
+    for (int i = 0; i < n; i++)
+        a[i] = 2*i;
+}
+
+void benchFillRandom (int a [ ], int n, unsigned long long * state) {
+    for (int i = 0; i < n; i++)
+        a[i] = benchRandom (state);
+}
+
+void benchFillDescending (int a [ ], int n, unsigned long long * state) {
+    (void) state;
+    for (int i = 0; i < n; i++)
+        a[i] = 2*(n - i - 1);
+}
+
+/* ascending data with about 1% late arrivals */
+void benchFillNearlySorted (int a [ ], int n, unsigned long long * state) {
+    for (int i = 0; i < n; i++)
+        a[i] = (benchRandom (state) % 100 == 0) ? benchRandom (state) % (2*n) : 2*i;
+}
+
+/* * * * * * * * * * * * * * * * registration  * * * * * * * * * * * * * * * * * */
+
+/** *******************************************************************************
+ * start registering a benchmark, with the ascending, random and descending       *
+ * data sets every program uses                                                   *
+ * @param  minSize  size of the smallest data set                                 *
+ * @param  maxSize  size of the largest data set                                  *
+ * @param  factor  each data set is this many times the size of the last          *
+ *********************************************************************************/
+void benchInit (int minSize, int maxSize, int factor) {
+    benchConf.minSize = minSize;
+    benchConf.maxSize = maxSize;
+    benchConf.factor = (factor > 1) ? factor : 2;
+    benchConf.trials = 5;
+    benchConf.maxTrials = 100;
+    benchConf.targetCI = 0.02;
+    benchConf.timeLimit = 5;
+    benchConf.warmup = 1;
+    benchConf.seed = 415;
+    benchConf.algFilter = NULL;
+    benchConf.shapeFilter = NULL;
+    benchConf.perf = 0;
+    benchConf.jsonFile = NULL;
+    benchConf.csvFile = NULL;
+    benchNumAlgs = 0;
+    benchNumShapes = 0;
+
+    benchShapes[benchNumShapes++] = (benchShape) {"ascending", benchFillAscending};
+    benchShapes[benchNumShapes++] = (benchShape) {"random", benchFillRandom};
+    benchShapes[benchNumShapes++] = (benchShape) {"descending", benchFillDescending};
+}
+
+/** *******************************************************************************
+ * add a kind of data set                                                         *
+ * @param  name  the name printed in the table and matched by --shapes            *
+ * @param  fill  generates n elements, drawing random values from state           *
+ *********************************************************************************/
+void benchAddShape (char * name, void (*fill) (int [ ], int, unsigned long long *)) {
+    if (benchNumShapes < benchMaxShapes)
+        benchShapes[benchNumShapes++] = (benchShape) {name, fill};
+}
+
+/* register an algorithm with its name tidied up for the table */
+benchAlg * benchAddAlg (char * name) {
+    if (benchNumAlgs == benchMaxAlgs) {
+        printf ("benchmark:  more than %d algorithms registered\n", benchMaxAlgs);
+        exit (1);
+    }
+    benchAlg * alg = &benchAlgs[benchNumAlgs++];
+    memset (alg, 0, sizeof(benchAlg));
+    snprintf (alg->name, sizeof(alg->name), "%s", name);
+    int last = strlen (alg->name) - 1;
+    while (last >= 0 && (alg->name[last] == ' ' || alg->name[last] == ':'))
+        alg->name[last--] = '\0';
+    return alg;
+}
+
+/* add a sort of the form  proc (a, n) */
+benchAlg * benchAddSort (char * name, void (*proc) (int [ ], int)) {
+    benchAlg * alg = benchAddAlg (name);
+    alg->sortProc = proc;
+    return alg;
+}
+
+/* add a sort of the form  proc (a, left, right) */
+benchAlg * benchAddRange (char * name, void (*proc) (int *, int, int)) {
+    benchAlg * alg = benchAddAlg (name);
+    alg->rangeProc = proc;
+    return alg;
+}
+
+/* add a partition of the form  pivotSpot = proc (a, size, left, right) */
+benchAlg * benchAddPartition (char * name, int (*proc) (int [ ], int, int, int)) {
+    benchAlg * alg = benchAddAlg (name);
+    alg->partitionProc = proc;
+    return alg;
+}
+
+/** *******************************************************************************
+ * skip an algorithm on data sets of one shape larger than maxSize, as for        *
+ * n^2 sorts or quicksorts that exhaust the run-time stack on ordered data        *
+ *********************************************************************************/
+void benchLimit (benchAlg * alg, char * shapeName, int maxSize) {
+    for (int s = 0; s < benchNumShapes; s++) {
+        if (strcmp (benchShapes[s].name, shapeName) == 0)
+            alg->maxSize[s] = maxSize;
+    }
+}
+
+/* * * * * * * * * * * * * * * * command line  * * * * * * * * * * * * * * * * * */
+
+/* does name contain one of the comma-separated patterns; NULL matches all */
+int benchMatches (char * name, char * patterns) {
+    if (patterns == NULL)
+        return 1;
+    char pattern [64];
+    while (*patterns != '\0') {
+        int length = strcspn (patterns, ",");
+        snprintf (pattern, sizeof(pattern), "%.*s", length, patterns);
+        if (length > 0 && strstr (name, pattern) != NULL)
+            return 1;
+        patterns += length;
+        if (*patterns == ',')
+            patterns++;
+    }
+    return 0;
+}
+
+/** *******************************************************************************
+ * read the --options of the command line into benchConf; arguments not           *
+ * starting with -- are left for the program                                      *
+ * @returns  0, or -1 after printing the options if one is not understood         *
+ *********************************************************************************/
+int benchParseArgs (int argc, char * argv [ ]) {
+    for (int i = 1; i < argc; i++) {
+        char * arg = argv[i];
+        if (strncmp (arg, "--", 2) != 0)
+            continue;
+        if (strncmp (arg, "--algs=", 7) == 0)
+            benchConf.algFilter = arg + 7;
+        else if (strncmp (arg, "--shapes=", 9) == 0)
+            benchConf.shapeFilter = arg + 9;
+        else if (strncmp (arg, "--sizes=", 8) == 0) {
+            char * colon = strchr (arg, ':');
+            benchConf.minSize = atoi (arg + 8);
+            benchConf.maxSize = (colon != NULL) ? atoi (colon + 1) : benchConf.minSize;
+        }
+        else if (strncmp (arg, "--trials=", 9) == 0)
+            benchConf.trials = atoi (arg + 9);
+        else if (strncmp (arg, "--max-trials=", 13) == 0)
+            benchConf.maxTrials = atoi (arg + 13);
+        else if (strncmp (arg, "--ci=", 5) == 0)
+            benchConf.targetCI = atof (arg + 5) / 100;
+        else if (strncmp (arg, "--time-limit=", 13) == 0)
+            benchConf.timeLimit = atof (arg + 13);
+        else if (strncmp (arg, "--warmup=", 9) == 0)
+            benchConf.warmup = atoi (arg + 9);
+        else if (strncmp (arg, "--seed=", 7) == 0)
+            benchConf.seed = strtoull (arg + 7, NULL, 10);
+        else if (strcmp (arg, "--perf") == 0)
+            benchConf.perf = 1;
+        else if (strncmp (arg, "--jsonl=", 8) == 0)
+            benchConf.jsonFile = arg + 8;
+        else if (strncmp (arg, "--csv=", 6) == 0)
+            benchConf.csvFile = arg + 6;
+        else {
+            printf ("usage:  %s [--algs=a,b] [--shapes=a,b] [--sizes=min:max]\n"
+                    "        [--trials=n] [--max-trials=n] [--ci=percent] [--time-limit=seconds]\n"
+                    "        [--warmup=n] [--seed=n] [--perf] [--jsonl=file] [--csv=file]\n",
+                    argv[0]);
+            return -1;
+        }
+    }
+    if (benchConf.trials < 1)
+        benchConf.trials = 1;
+    if (benchConf.trials > benchMaxTrials)
+        benchConf.trials = benchMaxTrials;
+    if (benchConf.maxTrials < benchConf.trials)
+        benchConf.maxTrials = benchConf.trials;
+    if (benchConf.maxTrials > benchMaxTrials)
+        benchConf.maxTrials = benchMaxTrials;
+    if (benchConf.warmup < 0)
+        benchConf.warmup = 0;
+    if (benchConf.minSize < 1)
+        benchConf.minSize = 1;
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * timing and checks  * * * * * * * * * * * * * * * */
+
+/* wall-clock time in seconds since an arbitrary fixed point, to the nanosecond */
+double benchNow ( ) {
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* CPU time in seconds used so far by the calling thread, to the nanosecond */
+double benchThreadCpu ( ) {
+    struct timespec now;
+    clock_gettime (CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int benchCompareDoubles (const void * x, const void * y) {
+    double a = * (const double *) x;
+    double b = * (const double *) y;
+    return (a > b) - (a < b);
+}
+
+/* value at fraction q of the way through n sorted samples */
+double benchQuantile (double sorted [ ], int n, double q) {
+    double spot = q * (n - 1);
+    int below = (int) spot;
+    if (below + 1 >= n)
+        return sorted[n-1];
+    return sorted[below] + (spot - below) * (sorted[below+1] - sorted[below]);
+}
+
+/* square root by Newton's method, so the programs need not link the math library */
+double benchSqrt (double x) {
+    if (x <= 0)
+        return 0;
+    double root = (x > 1) ? x : 1;
+    for (int i = 0; i < 100; i++) {
+        double next = (root + x / root) / 2;
+        if (next >= root)
+            break;
+        root = next;
+    }
+    return root;
+}
+
+/* two-sided 95% quantile of Student's t distribution with df degrees of freedom */
+double benchStudentT (int df) {
+    static const double table [10] = {0, 12.706, 4.303, 3.182, 2.776, 2.571,
+                                      2.447, 2.365, 2.306, 2.262};
+    if (df < 1)
+        return 0;
+    if (df < 10)
+        return table[df];
+    return 1.96 + 2.5 / df;
+}
+
+/** *******************************************************************************
+ * summarize timed runs, rejecting wall times beyond Tukey's fences when there    *
+ * are enough runs to find quartiles                                              *
+ * @param  wall  wall times of the runs, sorted into order by this function       *
+ * @param  cpu  thread CPU times of the runs, sorted into order by this function  *
+ * @param  n  the number of runs                                                  *
+ * @param  out  receives the statistics                                           *
+ *********************************************************************************/
+void benchSummarize (double wall [ ], double cpu [ ], int n, benchSummary * out) {
+    qsort (wall, n, sizeof(double), benchCompareDoubles);
+    qsort (cpu, n, sizeof(double), benchCompareDoubles);
+
+    int first = 0, last = n - 1;
+    if (n >= 4) {
+        double q1 = benchQuantile (wall, n, 0.25);
+        double q3 = benchQuantile (wall, n, 0.75);
+        double low = q1 - benchOutlierFence * (q3 - q1);
+        double high = q3 + benchOutlierFence * (q3 - q1);
+        while (first < last && wall[first] < low)
+            first++;
+        while (last > first && wall[last] > high)
+            last--;
+    }
+    double * kept = wall + first;
+    int k = last - first + 1;
+
+    double sum = 0;
+    for (int i = 0; i < k; i++)
+        sum += kept[i];
+    double mean = sum / k;
+    double squares = 0;
+    for (int i = 0; i < k; i++)
+        squares += (kept[i] - mean) * (kept[i] - mean);
+
+    out->trials = n;
+    out->outliers = n - k;
+    out->min = kept[0];
+    out->median = benchQuantile (kept, k, 0.5);
+    out->p95 = benchQuantile (kept, k, 0.95);
+    out->mean = mean;
+    out->ci = (k > 1 && mean > 0) ? benchStudentT (k - 1) * benchSqrt (squares / (k - 1) / k) / mean
+                                  : 0;
+    out->stddev = (k > 1) ? benchSqrt (squares / (k - 1)) : 0;
+    out->cpuMedian = benchQuantile (cpu, n, 0.5);
+}
+
+/** *******************************************************************************
+ * check the result of one run against its input                                  *
+ * @remark  a sort must leave the elements in non-descending order; a partition   *
+ *          must return the final spot of the pivot, the original first element,  *
+ *          with no larger element before it and no smaller one after.  Either    *
+ *          way the sum and exclusive or of the elements must be unchanged, a     *
+ *          cheap check that the result is a permutation of the input             *
+ * returns  "ok" if the result is correct; "NO" otherwise                         *
+ *********************************************************************************/
+char * benchCheck (benchAlg * alg, int input [ ], int output [ ], int n, int pivotSpot) {
+    long long sumIn = 0, sumOut = 0;
+    int xorIn = 0, xorOut = 0;
+    for (int i = 0; i < n; i++) {
+        sumIn += input[i];
+        sumOut += output[i];
+        xorIn ^= input[i];
+        xorOut ^= output[i];
+    }
+    if (sumIn != sumOut || xorIn != xorOut)
+        return "NO";
+
+    if (alg->partitionProc != NULL) {
+        if (pivotSpot < 0 || pivotSpot >= n || output[pivotSpot] != input[0])
+            return "NO";
+        for (int i = 0; i < n; i++) {
+            if (i < pivotSpot && output[i] > output[pivotSpot])
+                return "NO";
+            if (i > pivotSpot && output[i] < output[pivotSpot])
+                return "NO";
+        }
+        return "ok";
+    }
+
+    for (int i = 0; i < n-1; i++) {
+        if (output[i] > output[i+1])
+            return "NO";
+    }
+    return "ok";
+}
+
+/* run an algorithm once on a, returning the pivot spot of a partition */
+int benchCall (benchAlg * alg, int a [ ], int n) {
+    if (alg->sortProc != NULL)
+        alg->sortProc (a, n);
+    else if (alg->rangeProc != NULL)
+        alg->rangeProc (a, 0, n-1);
+    else
+        return alg->partitionProc (a, n, 0, n-1);
+    return 0;
+}
+
+/* base 2 logarithm of n, by halving, so the programs need not link the math library */
+double benchLog2 (double n) {
+    double log = 0;
+    while (n >= 2) {
+        n /= 2;
+        log++;
+    }
+    // linear between powers of 2, close enough for a normalization
+    return log + (n - 1);
+}
+
+/* * * * * * * * * * * * * * * hardware counters  * * * * * * * * * * * * * * * * */
+
+#define benchNumCounters 5    // cycles, instructions, branch, L1 data and LLC misses
+
+int benchCounterFd [benchNumCounters] = {-1, -1, -1, -1, -1};
+
+/** *******************************************************************************
+ * open the hardware counters for the calling thread and threads it creates       *
+ * later, counting user-mode events only, as perf_event_paranoid 2 allows         *
+ * @remark  a counter the processor or kernel cannot provide stays closed, and    *
+ *          its columns print as ---                                              *
+ * @returns  the number of counters opened                                        *
+ *********************************************************************************/
+int benchOpenCounters ( ) {
+    int opened = 0;
+#ifdef __linux__
+    unsigned int types [benchNumCounters] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                             PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                             PERF_TYPE_HARDWARE};
+    unsigned long long configs [benchNumCounters] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES};
+
+    for (int c = 0; c < benchNumCounters; c++) {
+        struct perf_event_attr attr;
+        memset (&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[c];
+        attr.config = configs[c];
+        attr.disabled = 1;
+        attr.inherit = 1;           // count the threads of parallel sorts too
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        benchCounterFd[c] = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (benchCounterFd[c] >= 0)
+            opened++;
+    }
+#endif
+    return opened;
+}
+
+void benchCloseCounters ( ) {
+    for (int c = 0; c < benchNumCounters; c++) {
+#ifdef __linux__
+        if (benchCounterFd[c] >= 0)
+            close (benchCounterFd[c]);
+#endif
+        benchCounterFd[c] = -1;
+    }
+}
+
+/* zero and start every open counter */
+void benchStartCounters ( ) {
+#ifdef __linux__
+    for (int c = 0; c < benchNumCounters; c++) {
+        if (benchCounterFd[c] >= 0) {
+            ioctl (benchCounterFd[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl (benchCounterFd[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+/* stop every open counter, adding its count to totals; closed ones add -1 */
+void benchStopCounters (long long totals [ ]) {
+    for (int c = 0; c < benchNumCounters; c++) {
+        long long count = -1;
+#ifdef __linux__
+        if (benchCounterFd[c] >= 0) {
+            ioctl (benchCounterFd[c], PERF_EVENT_IOC_DISABLE, 0);
+            if (read (benchCounterFd[c], &count, sizeof(count)) != sizeof(count))
+                count = -1;
+        }
+#endif
+        if (count < 0 || totals[c] < 0)
+            totals[c] = -1;
+        else
+            totals[c] += count;
+    }
+}
+
+/* print a counter ratio, or --- if either counter could not be read */
+void benchPrintRatio (long long numerator, double denominator) {
+    if (numerator < 0 || denominator <= 0)
+        printf (" %9s", "---");
+    else
+        printf (" %9.3lf", numerator / denominator);
+}
+
+/* * * * * * * * * * * * * * * * structured output  * * * * * * * * * * * * * * * */
+
+// fields of a JSON line or CSV row, in order; the numbers of the table, in
+// milliseconds, are written with the same precision or better
+#define benchNumFields 29
+
+char * benchFieldNames [benchNumFields] = {
+    "program", "algorithm", "shape", "n", "seed", "trials", "outliers",
+    "min_ms", "median_ms", "p95_ms", "mean_ms", "stddev_ms", "ci_pct", "cpu_median_ms",
+    "ipc", "branch_misses_per_n", "l1d_misses_per_n", "llc_misses_per_n",
+    "compares_per_n", "swaps_per_n", "writes_per_n", "check", "note",
+    "host", "cpu", "cpus", "compiler", "os", "date"};
+
+// fields written as numbers in JSON, rather than strings; an empty one is null
+int benchFieldIsNumber [benchNumFields] = {
+    0, 0, 0, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1,
+    1, 1, 1, 0, 0,
+    0, 0, 1, 0, 0, 0};
+
+#define benchFieldLength 160  // longest text of one field, with its terminator
+
+/** *******************************************************************************
+ * the machine and build a benchmark runs on, written with every record so        *
+ * a comparison can tell whether two files come from the same setup               *
+ *********************************************************************************/
+typedef struct benchMachine {
+    char host [64];              /**< host name                                   */
+    char cpu [benchFieldLength]; /**< processor model, from /proc/cpuinfo         */
+    int cpus;                    /**< processors online                           */
+    char compiler [80];          /**< compiler and version                        */
+    char os [80];                /**< system name and release                     */
+    char date [32];              /**< start of the run, UTC, ISO 8601             */
+} benchMachine;
+
+/* describe the machine and build; what cannot be found is "unknown" */
+void benchDescribeMachine (benchMachine * m) {
+    strcpy (m->host, "unknown");
+    strcpy (m->cpu, "unknown");
+    strcpy (m->os, "unknown");
+    m->cpus = 0;
+#ifdef __linux__
+    gethostname (m->host, sizeof(m->host));
+    m->host[sizeof(m->host) - 1] = '\0';
+    m->cpus = (int) sysconf (_SC_NPROCESSORS_ONLN);
+    struct utsname system;
+    if (uname (&system) == 0)
+        snprintf (m->os, sizeof(m->os), "%.20s %.40s %.15s", system.sysname, system.release,
+                  system.machine);
+    FILE * info = fopen ("/proc/cpuinfo", "r");
+    if (info != NULL) {
+        char line [256];
+        while (fgets (line, sizeof(line), info) != NULL) {
+            char * colon = strchr (line, ':');
+            if (strncmp (line, "model name", 10) == 0 && colon != NULL) {
+                snprintf (m->cpu, sizeof(m->cpu), "%s", colon + 2);
+                m->cpu[strcspn (m->cpu, "\n")] = '\0';
+                break;
+            }
+        }
+        fclose (info);
+    }
+#endif
+#ifdef __VERSION__
+#ifdef __clang__
+    snprintf (m->compiler, sizeof(m->compiler), "clang %s", __VERSION__);
+#elif defined (__GNUC__)
+    snprintf (m->compiler, sizeof(m->compiler), "gcc %s", __VERSION__);
+#else
+    snprintf (m->compiler, sizeof(m->compiler), "%s", __VERSION__);
+#endif
+#else
+    strcpy (m->compiler, "unknown");
+#endif
+    time_t now = time (NULL);
+    strftime (m->date, sizeof(m->date), "%Y-%m-%dT%H:%M:%SZ", gmtime (&now));
+}
+
+/* put a string in double quotes, doubling quotes for CSV or escaping them for JSON */
+void benchPutQuoted (FILE * out, char * text, int json) {
+    putc ('"', out);
+    for (char * c = text; *c != '\0'; c++) {
+        if (*c == '"')
+            fputs (json ? "\\\"" : "\"\"", out);
+        else if (json && *c == '\\')
+            fputs ("\\\\", out);
+        else if (json && (unsigned char) *c < ' ')
+            putc (' ', out);
+        else
+            putc (*c, out);
+    }
+    putc ('"', out);
+}
+
+/* write the CSV heading row */
+void benchWriteCsvHeading (FILE * csv) {
+    for (int f = 0; f < benchNumFields; f++)
+        fprintf (csv, "%s%s", (f > 0) ? "," : "", benchFieldNames[f]);
+    fprintf (csv, "\n");
+}
+
+/* write one record to whichever of the files are open */
+void benchWriteRecord (FILE * json, FILE * csv, char fields [ ][benchFieldLength]) {
+    if (json != NULL) {
+        for (int f = 0; f < benchNumFields; f++) {
+            fprintf (json, "%s\"%s\":", (f > 0) ? ", " : "{", benchFieldNames[f]);
+            if (!benchFieldIsNumber[f])
+                benchPutQuoted (json, fields[f], 1);
+            else
+                fputs ((fields[f][0] != '\0') ? fields[f] : "null", json);
+        }
+        fprintf (json, "}\n");
+        fflush (json);
+    }
+    if (csv != NULL) {
+        for (int f = 0; f < benchNumFields; f++) {
+            if (f > 0)
+                putc (',', csv);
+            if (benchFieldIsNumber[f])
+                fputs (fields[f], csv);
+            else
+                benchPutQuoted (csv, fields[f], 0);
+        }
+        fprintf (csv, "\n");
+        fflush (csv);
+    }
+}
+
+/* print a ratio into a field, leaving it empty if either count is missing */
+void benchFieldRatio (char field [ ], long long numerator, double denominator) {
+    if (numerator < 0 || denominator <= 0)
+        field[0] = '\0';
+    else
+        snprintf (field, benchFieldLength, "%.6lf", numerator / denominator);
+}
+
+/* * * * * * * * * * * * * * * * * the benchmark  * * * * * * * * * * * * * * * * */
+
+/** *******************************************************************************
+ * one row of the table: the statistics of one algorithm on one data set          *
+ *********************************************************************************/
+typedef struct benchResult {
+    char algorithm [40];                  /**< name of the algorithm               */
+    char shape [40];                      /**< name of the data set                */
+    long long n;                          /**< elements sorted                     */
+    benchSummary summary;                 /**< statistics of the timed runs        */
+    long long counts [benchNumCounters];  /**< hardware counts over the timed runs */
+    long long ops [benchNumOps];          /**< operations over the timed runs      */
+    int counted;                          /**< whether ops were counted            */
+    char * check;                         /**< "ok" or "NO"                        */
+    char note [128];                      /**< the program's figures, or ""        */
+} benchResult;
+
+// where the rows go, set up by benchBegin
+FILE * benchJson = NULL;
+FILE * benchCsv = NULL;
+benchMachine benchHost;
+char * benchProgram = "";
+
+/** *******************************************************************************
+ * read the command line, open the counters and output files, and print the       *
+ * headings of the table                                                          *
+ * @remark  a program timing its algorithms itself, rather than with benchRun,    *
+ *          calls benchBegin, then benchMeasure and benchReport, or benchSkip,    *
+ *          for each row, then benchEnd, so its rows are timed, printed and       *
+ *          recorded like those of benchRun                                       *
+ * @returns  0, or 1 if the command line was not understood or a file not opened  *
+ *********************************************************************************/
+int benchBegin (int argc, char * argv [ ]) {
+    if (benchParseArgs (argc, argv) < 0)
+        return 1;
+    if (benchConf.perf && benchOpenCounters () == 0) {
+        printf ("hardware counters unavailable; running without --perf\n");
+        benchConf.perf = 0;
+    }
+
+    // open the structured output files, if any
+    benchJson = NULL;
+    benchCsv = NULL;
+    benchProgram = strrchr (argv[0], '/');
+    benchProgram = (benchProgram != NULL) ? benchProgram + 1 : argv[0];
+    if (benchConf.jsonFile != NULL || benchConf.csvFile != NULL)
+        benchDescribeMachine (&benchHost);
+    if (benchConf.jsonFile != NULL && (benchJson = fopen (benchConf.jsonFile, "w")) == NULL) {
+        printf ("benchmark:  cannot write %s\n", benchConf.jsonFile);
+        benchCloseCounters ();
+        return 1;
+    }
+    if (benchConf.csvFile != NULL) {
+        if ((benchCsv = fopen (benchConf.csvFile, "w")) == NULL) {
+            printf ("benchmark:  cannot write %s\n", benchConf.csvFile);
+            if (benchJson != NULL)
+                fclose (benchJson);
+            benchJson = NULL;
+            benchCloseCounters ();
+            return 1;
+        }
+        benchWriteCsvHeading (benchCsv);
+    }
+
+    // print headings
+    printf ("%-22s %-13s %9s %6s %4s %12s %12s %12s %7s %12s", "Algorithm", "Data Set",
+            "Size", "Trials", "Out", "Min (ms)", "Median (ms)", "P95 (ms)", "+-CI %",
+            "CPU (ms)");
+    if (benchConf.perf)
+        printf (" %9s %9s %9s %9s", "IPC", "BrMiss/n", "L1Miss/n", "LLCMiss/n");
+    if (countOperations)
+        printf (" %9s %9s %9s %9s %9s %9s", "Cmp/n", "Swp/n", "Wr/n", "Cmp/nlgn",
+                "Swp/nlgn", "Wr/nlgn");
+    printf ("  %s\n", "Check");
+    return 0;
+}
+
+/* print the row of an algorithm skipped on a data set, as too large for it */
+void benchSkip (char * algorithm, char * shape, long long n) {
+    printf ("%-22s %-13s %9lld", algorithm, shape, n);
+    printf (" %6s %4s %12s %12s %12s %7s %12s", "---", "---", "---", "---", "---", "---",
+            "---");
+    if (benchConf.perf)
+        printf (" %9s %9s %9s %9s", "---", "---", "---", "---");
+    if (countOperations)
+        printf (" %9s %9s %9s %9s %9s %9s", "---", "---", "---", "---", "---", "---");
+    printf ("  %s\n", "--");
+}
+
+/* print the row of a result, and write its record to the files open */
+void benchReport (benchResult * r) {
+    benchSummary * summary = &r->summary;
+    printf ("%-22s %-13s %9lld", r->algorithm, r->shape, r->n);
+    printf (" %6d %4d %12.3lf %12.3lf %12.3lf %7.2lf %12.3lf", summary->trials,
+            summary->outliers, summary->min * 1000, summary->median * 1000,
+            summary->p95 * 1000, summary->ci * 100, summary->cpuMedian * 1000);
+
+    // counts and operations are summed over the timed runs, including any outliers
+    double elements = (double) r->n * summary->trials;
+    if (benchConf.perf) {
+        benchPrintRatio (r->counts[1], r->counts[0]);
+        benchPrintRatio (r->counts[2], elements);
+        benchPrintRatio (r->counts[3], elements);
+        benchPrintRatio (r->counts[4], elements);
+    }
+    if (countOperations) {
+        long long missing [benchNumOps] = {-1, -1, -1};
+        long long * ops = r->counted ? r->ops : missing;
+        for (int op = 0; op < benchNumOps; op++)
+            benchPrintRatio (ops[op], elements);
+        for (int op = 0; op < benchNumOps; op++)
+            benchPrintRatio (ops[op], elements * (r->n > 1 ? benchLog2 (r->n) : 1));
+    }
+    printf ("  %2s%s\n", r->check, r->note);
+
+    if (benchJson == NULL && benchCsv == NULL)
+        return;
+    char fields [benchNumFields][benchFieldLength];
+    char * text = r->note;
+    while (*text == ' ')
+        text++;
+    snprintf (fields[0], benchFieldLength, "%s", benchProgram);
+    snprintf (fields[1], benchFieldLength, "%.39s", r->algorithm);
+    snprintf (fields[2], benchFieldLength, "%.39s", r->shape);
+    snprintf (fields[3], benchFieldLength, "%lld", r->n);
+    snprintf (fields[4], benchFieldLength, "%llu", benchConf.seed);
+    snprintf (fields[5], benchFieldLength, "%d", summary->trials);
+    snprintf (fields[6], benchFieldLength, "%d", summary->outliers);
+    snprintf (fields[7], benchFieldLength, "%.6lf", summary->min * 1000);
+    snprintf (fields[8], benchFieldLength, "%.6lf", summary->median * 1000);
+    snprintf (fields[9], benchFieldLength, "%.6lf", summary->p95 * 1000);
+    snprintf (fields[10], benchFieldLength, "%.6lf", summary->mean * 1000);
+    snprintf (fields[11], benchFieldLength, "%.6lf", summary->stddev * 1000);
+    snprintf (fields[12], benchFieldLength, "%.4lf", summary->ci * 100);
+    snprintf (fields[13], benchFieldLength, "%.6lf", summary->cpuMedian * 1000);
+    long long missing [benchNumCounters] = {-1, -1, -1, -1, -1};
+    long long * measured = benchConf.perf ? r->counts : missing;
+    benchFieldRatio (fields[14], measured[1], measured[0]);
+    benchFieldRatio (fields[15], measured[2], elements);
+    benchFieldRatio (fields[16], measured[3], elements);
+    benchFieldRatio (fields[17], measured[4], elements);
+    for (int op = 0; op < benchNumOps; op++)
+        benchFieldRatio (fields[18 + op], (countOperations && r->counted) ? r->ops[op] : -1,
+                         elements);
+    snprintf (fields[21], benchFieldLength, "%s", r->check);
+    snprintf (fields[22], benchFieldLength, "%s", text);
+    snprintf (fields[23], benchFieldLength, "%s", benchHost.host);
+    snprintf (fields[24], benchFieldLength, "%s", benchHost.cpu);
+    snprintf (fields[25], benchFieldLength, "%d", benchHost.cpus);
+    snprintf (fields[26], benchFieldLength, "%s", benchHost.compiler);
+    snprintf (fields[27], benchFieldLength, "%s", benchHost.os);
+    snprintf (fields[28], benchFieldLength, "%s", benchHost.date);
+    benchWriteRecord (benchJson, benchCsv, fields);
+}
+
+/* close the counters and output files opened by benchBegin */
+void benchEnd ( ) {
+    benchCloseCounters ();
+    if (benchJson != NULL)
+        fclose (benchJson);
+    if (benchCsv != NULL)
+        fclose (benchCsv);
+    benchJson = NULL;
+    benchCsv = NULL;
+}
+
+/** *******************************************************************************
+ * time one algorithm on one data set, repeating runs as benchRun does            *
+ * @param  prepare  sets up the data of a run, outside the timing, as by copying  *
+ *                  the input over the last run's output                          *
+ * @param  run      the run to time                                               *
+ * @param  context  passed to prepare and run                                     *
+ * @param  r        receives the statistics, counts, operations and note; its     *
+ *                  names, size and check are left to the caller                  *
+ * @remark  after the warmup runs, runs repeat past the fewest trials until the   *
+ *          confidence interval of the mean is narrow enough, the most trials     *
+ *          are done, or the time limit is spent.  The output of the last run     *
+ *          is left in place to be checked                                        *
+ *********************************************************************************/
+void benchMeasure (void (*prepare) (void *), void (*run) (void *), void * context,
+                   benchResult * r) {
+    static double wall [benchMaxTrials];
+    static double cpu [benchMaxTrials];
+    static double sortedWall [benchMaxTrials];
+    static double sortedCpu [benchMaxTrials];
+
+    for (int w = 0; w < benchConf.warmup; w++) {
+        prepare (context);
+        run (context);
+    }
+    memset (&r->summary, 0, sizeof(r->summary));
+    memset (r->counts, 0, sizeof(r->counts));
+    memset (r->ops, 0, sizeof(r->ops));
+    r->note[0] = '\0';
+    double spent = 0;
+    int trials = 0;
+    while (trials < benchConf.maxTrials) {
+        prepare (context);
+        if (benchResetHook != NULL)
+            benchResetHook ();
+        memset (benchOps, 0, sizeof(benchOps));
+        if (benchConf.perf)
+            benchStartCounters ();
+        double start_cpu = benchThreadCpu ();
+        double start_time = benchNow ();
+        run (context);
+        wall[trials] = benchNow () - start_time;
+        cpu[trials] = benchThreadCpu () - start_cpu;
+        if (benchConf.perf)
+            benchStopCounters (r->counts);
+        for (int op = 0; op < benchNumOps; op++)
+            r->ops[op] += benchOps[op];
+        spent += wall[trials];
+        trials++;
+
+        // summarize copies, as summarizing sorts them
+        if (trials >= benchConf.trials) {
+            memcpy (sortedWall, wall, trials * sizeof(double));
+            memcpy (sortedCpu, cpu, trials * sizeof(double));
+            benchSummarize (sortedWall, sortedCpu, trials, &r->summary);
+            if (r->summary.ci <= benchConf.targetCI || spent >= benchConf.timeLimit)
+                break;
+        }
+    }
+
+    if (benchNoteHook != NULL)
+        benchNoteHook (r->note, sizeof(r->note));
+}
+
+// a registered algorithm's run on a copy of one data set, for benchRun
+typedef struct benchTrial {
+    benchAlg * alg;
+    int * input;
+    int * work;
+    int n;
+    int pivotSpot;
+} benchTrial;
+
+void benchCopyInput (void * context) {
+    benchTrial * t = (benchTrial *) context;
+    memcpy (t->work, t->input, t->n * sizeof(int));
+}
+
+void benchCallTrial (void * context) {
+    benchTrial * t = (benchTrial *) context;
+    t->pivotSpot = benchCall (t->alg, t->work, t->n);
+}
+
+/** *******************************************************************************
+ * time every registered algorithm on every data set, as filtered by the command  *
+ * line, printing statistics of the timed runs                                    *
+ * @remark  every algorithm of one size and shape runs on copies of the same      *
+ *          data, copied before each run, outside the timing, and is timed by     *
+ *          benchMeasure                                                          *
+ * @returns  0, or 1 if the command line was not understood                       *
+ *********************************************************************************/
+int benchRun (int argc, char * argv [ ]) {
+    if (benchBegin (argc, argv) != 0)
+        return 1;
+
+    for (long long size = benchConf.minSize; size <= benchConf.maxSize; size *= benchConf.factor) {
+        int n = (int) size;
+        printf ("\n");
+
+        // generate every data set of this size once, from the same seed
+        int * inputs [benchMaxShapes];
+        for (int s = 0; s < benchNumShapes; s++) {
+            inputs[s] = NULL;
+            if (!benchMatches (benchShapes[s].name, benchConf.shapeFilter))
+                continue;
+            unsigned long long state = benchConf.seed + s;
+            inputs[s] = (int *) malloc (n * sizeof(int));
+            benchShapes[s].fill (inputs[s], n, &state);
+        }
+        int * work = (int *) malloc (n * sizeof(int));
+
+        for (int a = 0; a < benchNumAlgs; a++) {
+            benchAlg * alg = &benchAlgs[a];
+            if (!benchMatches (alg->name, benchConf.algFilter))
+                continue;
+
+            for (int s = 0; s < benchNumShapes; s++) {
+                if (inputs[s] == NULL)
+                    continue;
+                if (alg->maxSize[s] > 0 && n > alg->maxSize[s]) {
+                    benchSkip (alg->name, benchShapes[s].name, n);
+                    continue;
+                }
+
+                benchTrial trial = {alg, inputs[s], work, n, 0};
+                benchResult result;
+                memset (&result, 0, sizeof(result));
+                snprintf (result.algorithm, sizeof(result.algorithm), "%.39s", alg->name);
+                snprintf (result.shape, sizeof(result.shape), "%.39s", benchShapes[s].name);
+                result.n = n;
+                result.counted = alg->counted;
+                benchMeasure (benchCopyInput, benchCallTrial, &trial, &result);
+                result.check = benchCheck (alg, inputs[s], work, n, trial.pivotSpot);
+                benchReport (&result);
+            }
+        }
+
+        for (int s = 0; s < benchNumShapes; s++)
+            free (inputs[s]);
+        free (work);
+    }
+    benchEnd ();
+    return 0;
+}
+
+#endif
@@ -27,8 +27,11 @@
 #include <stdlib.h>   // for malloc, free
 #include <time.h>     // for time
 
-#define printOrder 0    // 1 displays the before and after for the sorts
-                        // 0 does not display
+#include "benchmark.h" // shared timing harness
+
+#define inPlaceBlock      20    // in-place merge sort insertion sorts blocks this size first
+#define inPlaceBufferSize 256   // fixed stack buffer for small merges in the in-place merge sort
+                                // 0 merges by rotations alone
 
 /** *******************************************************************************
  * structure to identify both the name of a partition algorithm and               *
@@ -77,82 +80,140 @@ char * checkArrayOrder (int *array, int size) {
 }
 
 
+/** *******************************************************************************
+ * workspace for the merge sorts, owned by the caller and reused between sorts    *
+ * @remark  scratch holds the left half of each merge, and runStart the run       *
+ *          boundaries of the natural merge sort; both grow on demand only, so    *
+ *          repeated sorts of the same size do not allocate at all                *
+ *********************************************************************************/
+typedef struct mergeWorkspace {
+    int * scratch;
+    int * runStart;
+    int capacity;
+} mergeWorkspace;
+
+// workspace used by the merge sorts in the driver table
+mergeWorkspace sortWorkspace = {NULL, NULL, 0};
+
+/** *******************************************************************************
+ * make sure a workspace can hold the merges for an array segment                 *
+ * @param ws      the workspace                                                   *
+ * @param size    the number of elements in the segment to be sorted              *
+ * @post ws->scratch holds at least size elements and ws->runStart size+1         *
+ *********************************************************************************/
+void reserveWorkspace(mergeWorkspace *ws, int size) {
+    if (ws->capacity < size) {
+        free (ws->scratch);
+        free (ws->runStart);
+        ws->scratch = (int *) malloc (size * sizeof(int));
+        ws->runStart = (int *) malloc ((size + 1) * sizeof(int));
+        ws->capacity = size;
+    }
+}
+
+/** *******************************************************************************
+ * release the memory held by a workspace                                         *
+ * @param ws      the workspace                                                   *
+ * @post ws is empty and may be reserved again                                    *
+ *********************************************************************************/
+void freeWorkspace(mergeWorkspace *ws) {
+    free (ws->scratch);
+    free (ws->runStart);
+    ws->scratch = NULL;
+    ws->runStart = NULL;
+    ws->capacity = 0;
+}
+
 /** *******************************************************************************
  * kernel function of the merge sort                                              *
- * @remark  function taken from tutorialspoint.com as instructed in the           *
- *            assignment and will be used for the recursive version and the       *
- *            iterative version                                                   *
+ * @remark  adapted from the tutorialspoint.com version used for the recursive    *
+ *            and iterative versions: only the left half is copied out, to        *
+ *            the caller's scratch buffer, and merged forward into the array,     *
+ *            so right half elements still left at the end are already in place   *
  * @param array   the array to be sorted                                          *
  * @param l       left most point of the array                                    *
  * @param m       the middle of the array                                         *
  * @param r       right most point of the array                                   *
+ * @param scratch room for at least m-l+1 elements                                *
  * @post sorts the section of array passed as a parameter                         *
  *********************************************************************************/
-void mergeKernel(int *array, int l, int m, int r) {
-    int i, j, k, nl, nr;
-    //size of left and right sub-arrays
-    nl = m-l+1; nr = r-m;
-    int larr[nl], rarr[nr];
-    //fill left and right sub-arrays
+void mergeKernel(int *array, int l, int m, int r, int *scratch) {
+    int i, j, k, nl;
+    //size of left sub-array
+    nl = m-l+1;
     for(i = 0; i<nl; i++)
-        larr[i] = array[l+i];
-    for(j = 0; j<nr; j++)
-        rarr[j] = array[m+1+j];
-    i = 0; j = 0; k = l;
-    //marge temp arrays to real array
-    while(i < nl && j<nr) {
-        if(larr[i] <= rarr[j]) {
-            array[k] = larr[i];
+        scratch[i] = array[l+i];
+    i = 0; j = m+1; k = l;
+    //merge left copy and right sub-array into real array
+    while(i < nl && j <= r) {
+        if(scratch[i] <= array[j]) {
+            array[k] = scratch[i];
             i++;
         }else{
-            array[k] = rarr[j];
+            array[k] = array[j];
             j++;
         }
         k++;
     }
     while(i<nl) {       //extra element in left array
-        array[k] = larr[i];
+        array[k] = scratch[i];
         i++; k++;
     }
-    while(j<nr) {       //extra element in right array
-        array[k] = rarr[j];
-        j++; k++;
-    }
 }
 
 /** *******************************************************************************
- * function of the recursive merge sort                                           *
- * @remark  function taken from tutorialspoint.com as instructed in the homework  *
+ * helper for the recursive merge sort                                            *
  * @param array   the array to be sorted                                          *
  * @param l       left most point of the array                                    *
  * @param r       right most point of the array                                   *
+ * @param scratch room for at least (r-l+2)/2 elements                            *
  * @post sorts the array passed as a parameter                                    *
  *********************************************************************************/
-void mergeSortRecursive(int *array, int l, int r) {
+void mergeSortRecursiveHelper(int *array, int l, int r, int *scratch) {
     if(l < r) {
         int m = l+(r-l)/2;
         // Sort first and second arrays
-        mergeSortRecursive(array, l, m);
-        mergeSortRecursive(array, m + 1, r);
-        mergeKernel(array, l, m, r);
+        mergeSortRecursiveHelper(array, l, m, scratch);
+        mergeSortRecursiveHelper(array, m + 1, r, scratch);
+        mergeKernel(array, l, m, r, scratch);
     }
 }
 
+/** *******************************************************************************
+ * function of the recursive merge sort, using the caller's workspace             *
+ * @remark  function taken from tutorialspoint.com as instructed in the homework  *
+ * @param array   the array to be sorted                                          *
+ * @param l       left most point of the array                                    *
+ * @param r       right most point of the array                                   *
+ * @param ws      workspace, grown if too small for the array                     *
+ * @post sorts the array passed as a parameter                                    *
+ *********************************************************************************/
+void mergeSortRecursiveWs(int *array, int l, int r, mergeWorkspace *ws) {
+    reserveWorkspace(ws, r - l + 1);
+    mergeSortRecursiveHelper(array, l, r, ws->scratch);
+}
+
+void mergeSortRecursive(int *array, int l, int r) {
+    mergeSortRecursiveWs(array, l, r, &sortWorkspace);
+}
+
 
 /** *******************************************************************************
- * function of the iterative merge sort                                           *
+ * function of the iterative merge sort, using the caller's workspace             *
  * @remark  function taken from tutorialspoint.com as instructed in the homework  *
  * @param array   the array to be sorted                                          *
  * @param l       left most point of the array                                    *
  * @param r       right most point of the array                                   *
+ * @param ws      workspace, grown if too small for the array                     *
  * @pre  array size must be size 2 or larger, otherwise, displays error message   *
  * @post sorts the array passed as a parameter                                    *
  *********************************************************************************/
-void mergeSortIterative(int *array, int l, int r) {
+void mergeSortIterativeWs(int *array, int l, int r, mergeWorkspace *ws) {
     int size = r+1, leftPtr, rightPtr, m;
 
     // check that there is at least two elements in the array
     if (size >= 2) {
+        reserveWorkspace(ws, size);
         for (int segSize = 1; segSize < size; segSize *= 2) {
             for (leftPtr = 0; leftPtr < size - 1; leftPtr += 2 * segSize) {
                 // find ending point of left subarray
@@ -168,7 +229,7 @@ void mergeSortIterative(int *array, int l, int r) {
                     rightPtr = size - 1;
 
                 // sort the current segment of array
-                mergeKernel(array, leftPtr, m, rightPtr);
+                mergeKernel(array, leftPtr, m, rightPtr, ws->scratch);
             }
         }
     }
@@ -178,123 +239,223 @@ void mergeSortIterative(int *array, int l, int r) {
     }
 }
 
+void mergeSortIterative(int *array, int l, int r) {
+    mergeSortIterativeWs(array, l, r, &sortWorkspace);
+}
+
+/** *******************************************************************************
+ * function of the natural merge sort, using the caller's workspace               *
+ * @remark  finds the runs already in the array, reversing strictly descending    *
+ *          runs in place so equal elements keep their order, then merges         *
+ *          neighboring runs in passes, halving the number of runs each pass      *
+ *          so merges stay balanced.  An ascending array takes one pass to find   *
+ *          its single run and no merges                                          *
+ * @param array   the array to be sorted                                          *
+ * @param l       left most point of the array                                    *
+ * @param r       right most point of the array                                   *
+ * @param ws      workspace, grown if too small for the array                     *
+ * @post sorts the array passed as a parameter                                    *
+ *********************************************************************************/
+void mergeSortNaturalWs(int *array, int l, int r, mergeWorkspace *ws) {
+    if (l >= r)
+        return;
+    reserveWorkspace(ws, r - l + 1);
+
+    // runStart[k] is the first index of run k; runStart[numRuns] is r+1
+    int * runStart = ws->runStart;
+    int numRuns = 0;
+    int i = l;
+    while (i <= r) {
+        runStart[numRuns++] = i;
+        int j = i + 1;
+        if (j <= r && array[j] < array[i]) {
+            // strictly descending run: find its end and reverse it
+            while (j <= r && array[j] < array[j-1])
+                j++;
+            for (int lo = i, hi = j - 1; lo < hi; lo++, hi--)
+                swap (&array[lo], &array[hi]);
+        }
+        else {
+            while (j <= r && array[j] >= array[j-1])
+                j++;
+        }
+        i = j;
+    }
+    runStart[numRuns] = r + 1;
+
+    // merge pairs of neighboring runs until one run remains
+    while (numRuns > 1) {
+        int k, newRuns = 0;
+        for (k = 0; k + 1 < numRuns; k += 2) {
+            mergeKernel(array, runStart[k], runStart[k+1] - 1, runStart[k+2] - 1, ws->scratch);
+            runStart[newRuns++] = runStart[k];
+        }
+        if (k < numRuns)        // odd run out carries over to the next pass
+            runStart[newRuns++] = runStart[k];
+        runStart[newRuns] = r + 1;
+        numRuns = newRuns;
+    }
+}
+
+void mergeSortNatural(int *array, int l, int r) {
+    mergeSortNaturalWs(array, l, r, &sortWorkspace);
+}
+
+/** *******************************************************************************
+ * reverse a section of an array                                                  *
+ * @param array   the array                                                       *
+ * @param lo      first index of the section                                      *
+ * @param hi      last index of the section                                       *
+ * @post array[lo..hi] is in the opposite order                                   *
+ *********************************************************************************/
+void reverseSection(int *array, int lo, int hi) {
+    for (; lo < hi; lo++, hi--)
+        swap (&array[lo], &array[hi]);
+}
+
+/** *******************************************************************************
+ * rotate array[first..last-1] so that array[middle] comes first, by three        *
+ * reversals and no extra memory                                                  *
+ *********************************************************************************/
+void rotateSection(int *array, int first, int middle, int last) {
+    reverseSection(array, first, middle - 1);
+    reverseSection(array, middle, last - 1);
+    reverseSection(array, first, last - 1);
+}
+
+/** *******************************************************************************
+ * stable merge of array[a..m-1] with array[m..b-1] using no more than a fixed    *
+ * buffer of inPlaceBufferSize elements                                           *
+ * @remark  the SymMerge algorithm of Kim and Kutzner: find the split points      *
+ *          making the segments around the middle symmetric, rotate them into     *
+ *          place, and merge each side recursively.  Recursion depth is           *
+ *          O(log n); once the shorter run fits in the buffer it is merged        *
+ *          directly, forward or backward                                         *
+ * @param array   the array holding the two sorted runs                           *
+ * @param a       first index of the left run                                     *
+ * @param m       first index of the right run                                    *
+ * @param b       one past the last index of the right run                        *
+ * @post array[a..b-1] is sorted, equal elements kept in their original order     *
+ *********************************************************************************/
+void symMerge(int *array, int a, int m, int b) {
+    if (a >= m || m >= b || array[m-1] <= array[m])
+        return;
+
+#if inPlaceBufferSize > 0
+    int buffer [inPlaceBufferSize];
+    int i, j, k;
+    if (m - a <= inPlaceBufferSize) {
+        // copy the left run out and merge forward
+        for (i = 0; i < m - a; i++)
+            buffer[i] = array[a+i];
+        i = 0; j = m; k = a;
+        while (i < m - a && j < b)
+            array[k++] = (array[j] < buffer[i]) ? array[j++] : buffer[i++];
+        while (i < m - a)
+            array[k++] = buffer[i++];
+        return;
+    }
+    if (b - m <= inPlaceBufferSize) {
+        // copy the right run out and merge backward
+        for (j = 0; j < b - m; j++)
+            buffer[j] = array[m+j];
+        i = m - 1; j = b - m - 1; k = b - 1;
+        while (i >= a && j >= 0)
+            array[k--] = (buffer[j] < array[i]) ? array[i--] : buffer[j--];
+        while (j >= 0)
+            array[k--] = buffer[j--];
+        return;
+    }
+#endif
+
+    int mid = a + (b - a) / 2;
+    int n = mid + m;
+    int start, r;
+    if (m > mid) {
+        start = n - b;
+        r = mid;
+    }
+    else {
+        start = a;
+        r = m;
+    }
+    int p = n - 1;
+    while (start < r) {
+        int c = start + (r - start) / 2;
+        if (array[p-c] >= array[c])
+            start = c + 1;
+        else
+            r = c;
+    }
+    int end = n - start;
+    if (start < m && m < end)
+        rotateSection(array, start, m, end);
+    if (a < start && start < mid)
+        symMerge(array, a, start, mid);
+    if (mid < end && end < b)
+        symMerge(array, mid, end, b);
+}
+
+/** *******************************************************************************
+ * function of the in-place merge sort                                            *
+ * @remark  insertion sorts blocks of inPlaceBlock elements, then merges them     *
+ *          bottom up with symMerge, so extra memory is the fixed buffer and      *
+ *          the O(log n) recursion of the merges rather than a copy of the        *
+ *          array; the price is O(n log^2 n) element moves in the worst case      *
+ * @param array   the array to be sorted                                          *
+ * @param l       left most point of the array                                    *
+ * @param r       right most point of the array                                   *
+ * @post sorts the array passed as a parameter, keeping equal elements in order   *
+ *********************************************************************************/
+void mergeSortInPlace(int *array, int l, int r) {
+    int size = r + 1;
+
+    for (int lo = l; lo < size; lo += inPlaceBlock) {
+        int hi = (lo + inPlaceBlock < size) ? lo + inPlaceBlock : size;
+        for (int i = lo + 1; i < hi; i++) {
+            int item = array[i];
+            int j = i - 1;
+            while (j >= lo && array[j] > item) {
+                array[j+1] = array[j];
+                j--;
+            }
+            array[j+1] = item;
+        }
+    }
+
+    for (int segSize = inPlaceBlock; segSize < size - l; segSize *= 2) {
+        for (int lo = l; lo + segSize < size; lo += 2 * segSize) {
+            int hi = (lo + 2 * segSize < size) ? lo + 2 * segSize : size;
+            symMerge(array, lo, lo + segSize, hi);
+        }
+    }
+}
+
 /** *******************************************************************************
  * driver program for testing and timing partition algorithms                     *
  *********************************************************************************/
 
-int main() {
+int main(int argc, char *argv[]) {
     srand(time(NULL));
 
     // identify partition procedures used and their descriptive names
-    #define numAlgs  2
+    #define numAlgs  4
     partitionType procArray [numAlgs] = {{"Merge Sort Recursive: ", mergeSortRecursive},
-                                         {"Merge Sort Iterative: ", mergeSortIterative}};
+                                         {"Merge Sort Iterative: ", mergeSortIterative},
+                                         {"Merge Sort Natural:   ", mergeSortNatural},
+                                         {"Merge Sort In-Place:  ", mergeSortInPlace}};
 
     // print output headers
-    printf ("timing/testing of partition functions\n");
-    // print headings
-    printf ("                       Data Set              Times (milliseconds)\n");
-    printf ("Algorithm                Size     Ascending Order   Random Order   Descending Order\n");
-
-    int size;
-
-    // organize data sets of increasing size for ascending, random, and descending data 10000 160000
-    for (size = 10000; size <= 160000; size *= 2) {
-        // create control and initial data set arrays
-        int * asc = (int *) malloc (size * sizeof(int));   //array with ascending data
-        int * ran = (int *) malloc (size * sizeof(int));   //array with random data
-        int * des = (int *) malloc (size * sizeof(int));   // array with descending data
-
-        int i;
-        for (i = 0; i< size; i++) {
-            asc[i] = 2*i;
-            ran[i] = rand();
-            des[i] = 2*(size - i - 1);
-        }
-
-        // copy to test arrays
-        int * tempAsc = (int *) malloc (size * sizeof(int));
-        int * tempRan = (int *) malloc (size * sizeof(int));
-        int * tempDes = (int *) malloc (size * sizeof(int));
-
-        // repeat for each algorithm
-        for (int alg = 0; alg < numAlgs; alg++) {
-            // identify function and data set size
-            printf ("%s %7d", procArray[alg].name, size);
-            // timing variables
-            clock_t start_time, end_time;
-            double elapsed_time;
-
-            /* * * * * * * * * * * * * * * * * * * * * * * *
-             *      test and time algorithm:  algProc[alg] *
-             * * * * * * * * * * * * * * * * * * * * * * * */
-
-            /* * * * * * * test ascending data * * * * * * */
-            // timing for algorithm
-            for (i = 0; i< size; i++) {
-                tempAsc[i] = asc[i];
-            }
-            start_time = clock ();
-            procArray[alg].proc (tempAsc, 0, size-1);
-            end_time = clock();
-            //Timing displayed in milliseconds
-            elapsed_time = (end_time - start_time) / (double) (CLOCKS_PER_SEC/1000);
-            printf ("%13.1lf %s", elapsed_time, checkArrayOrder(tempAsc, size));
-            //printf(" %s", checkArrayOrder(tempAsc, size));
-
-            /* * * * * * * test random data * * * * * * */
-            // timing for algorithm
-            for (i = 0; i< size; i++) {
-                tempRan[i] = ran[i];
-            }
-            start_time = clock ();
-            procArray[alg].proc (tempRan, 0, size-1);
-            end_time = clock();
-            //Timing displayed in milliseconds
-            elapsed_time = (end_time - start_time) / (double) (CLOCKS_PER_SEC/1000);
-            printf ("%13.1lf %s", elapsed_time, checkArrayOrder(tempRan, size));
-
-            /* * * * * * * test descending data * * * * * * */
-            // timing for algoirthm
-            for (i = 0; i< size; i++) {
-                tempDes[i] = des[i];
-            }
-            start_time = clock ();
-            procArray[alg].proc (tempDes, 0, size-1);
-            end_time = clock();
-            //Timing displayed in milliseconds
-            elapsed_time = (end_time - start_time) / (double) (CLOCKS_PER_SEC/1000);
-            printf ("%13.1lf %s", elapsed_time, checkArrayOrder(tempDes, size));
-
-            printf ("\n");
-        } // end of loop for testing an algorithm
-
-        // leave blank line before output of next size
-        printf ("\n");
-
-        if (printOrder == 1) {
-            // print before sort
-            printf("\nRandom order array before either sort (each use the unsorted version and then sort):\n");
-            printArray(ran, size);
-            // print after sort
-            printf("Random order array after recursive sort:\n");
-            printArray(tempRan, size);
-            // print after sort
-            printf("Random order array after iterative sort:\n");
-            printArray(tempRan, size);
-        }
-
-        // clean up copies of test arrays
-        free (tempAsc);
-        free (tempRan);
-        free (tempDes);
+    printf ("timing/testing of merge sort functions\n");
 
-        // clean up original test arrays
-        free (asc);
-        free (ran);
-        free (des);
+    // time every algorithm with the shared benchmark harness
+    benchInit (10000, 5120000, 2);
+    benchAddShape ("nearly sorted", benchFillNearlySorted);
+    for (int alg = 0; alg < numAlgs; alg++)
+        benchAddRange (procArray[alg].name, procArray[alg].proc);
+    int status = benchRun (argc, argv);
 
-    } // end of loop for testing procedures with different array sizes
+    freeWorkspace(&sortWorkspace);
 
     int minHeap[] = {0,0,0,0,0,0,0,0,0,0,0,0,0};
     int minHeapRev[13] = {};
@@ -315,5 +476,5 @@ int main() {
 
     printArray(minHeap, 13);
 
-    return 0;
+    return status;
 }
\ No newline at end of file
@@ -27,7 +27,8 @@
 #include <stdlib.h>   // for malloc, free
 #include <time.h>     // for time
 
-#define printCopyTime 0  // 1 =  print times to copy arrays; 0 = omit this output
+#include "benchmark.h"      // shared timing harness
+#include "simd-partition.h" // SIMD partition kernels and dispatch
 
 /** *******************************************************************************
  * structure to identify both the name of a partition algorithm and               *
@@ -50,36 +51,7 @@ void swap (int * a, int * b) {
   int temp = * a;
   * a = * b;
   *b = temp;
-}
-
-/** *******************************************************************************
- * procedure to help check partition worked correctly                             *
- * @param  pivotSpot   index where pivot was supposed to be moved                 *
- * @param correctPivot value that should have been used as the pivot in partition *
- * @param a            the array being partitioned                                *
- * @param first        the index at the start of the segment to be partitioned    *
- * @param last         the index at the end of the segment to be partitioned      *
- * @post returns NO1 if correctPivot is not at index pivotSpot                    *
- *               NO2 if at least one elements between index first and pivotSpot   *
- *                      are greater than correctPivot                             *
- *               NO3 if at least one elements between index pivotSpot and last    *
- *                      are less than correctPivot                                *
- *               OK! if the array segment passes the above checks                 *
- *********************************************************************************/
-char * checkPivotSpot (int pivotSpot, int correctPivot, int a [ ], int first, int last) {
-  if( a[pivotSpot] != correctPivot) {
-    return "NO1";
-  }
-  int i;
-  for (i = first; i < pivotSpot; i++) {
-    if (a[i] > a[pivotSpot])
-      return "NO2";
-  }
-  for (i = pivotSpot+1; i <= last; i++) {
-    if (a[i] < a[pivotSpot])
-      return "NO3";
-  }
-  return "OK!";
+  opSwap ();
 }
 
 /** *******************************************************************************
@@ -105,9 +77,9 @@ int invariant1a (int a[ ], int size, int left, int right) {
   int temp;
 
   while (l_spot <= r_spot) {
-    while( (l_spot <= r_spot) && (a[r_spot] >= pivot))
+    while( (l_spot <= r_spot) && opCompare (a[r_spot] >= pivot))
       r_spot--;
-    while ((l_spot <= r_spot) && (a[l_spot] <= pivot))
+    while ((l_spot <= r_spot) && opCompare (a[l_spot] <= pivot))
       l_spot++;
 
     // if misplaced small and large values found, swap them
@@ -115,6 +87,7 @@ int invariant1a (int a[ ], int size, int left, int right) {
       temp = a[l_spot];
       a[l_spot] = a[r_spot];
       a[r_spot] = temp;
+      opSwap ();
       l_spot++;
       r_spot--;
       }
@@ -124,6 +97,7 @@ int invariant1a (int a[ ], int size, int left, int right) {
   temp = a[left];
   a[left] = a[r_spot];
   a[r_spot] = temp;
+  opSwap ();
   return r_spot;
 }
 
@@ -150,9 +124,9 @@ int invariant1aSwap (int a[ ], int size, int left, int right) {
   int temp;
 
   while (l_spot <= r_spot) {
-    while( (l_spot <= r_spot) && (a[r_spot] >= pivot))
+    while( (l_spot <= r_spot) && opCompare (a[r_spot] >= pivot))
       r_spot--;
-    while ((l_spot <= r_spot) && (a[l_spot] <= pivot))
+    while ((l_spot <= r_spot) && opCompare (a[l_spot] <= pivot))
       l_spot++;
 
     // if misplaced small and large values found, swap them
@@ -193,7 +167,7 @@ int invariant1b (int a[ ], int size ,int first, int last) {
   int right = last;
 
   for (left = first+1; left <= right;) {
-    if (a[left] < pivot) {
+    if (opCompare (a[left] < pivot)) {
       left++;
     }
     else {
@@ -233,7 +207,7 @@ int invariant2 (int a[ ], int size ,int first, int last) {
 
     while (right <= last)
     {
-        if (pivot < a[right])
+        if (opCompare (pivot < a[right]))
             right++;
         else {
             swap (&a[left], &a[right]);
@@ -273,7 +247,7 @@ int invariant3 (int a[ ], int size ,int first, int last) {
 
     while (left > first)
     {
-        if (pivot > a[left])
+        if (opCompare (pivot > a[left]))
             left--;
         else {
             swap (&a[left], &a[right]);
@@ -288,162 +262,306 @@ int invariant3 (int a[ ], int size ,int first, int last) {
 }
 
 
+/** *******************************************************************************
+ * procedure implements a branchless block partition, after BlockQuicksort        *
+ *    (S. Edelkamp and A. Weiss, "BlockQuicksort: Avoiding Branch Mispredictions  *
+ *    in Quicksort", ESA 2016)                                                    *
+ *    in brief: like invariant 1a, but a block of blockSize elements at each end  *
+ *              is scanned first, recording the offsets of misplaced elements     *
+ *              with no data-dependent branch; recorded pairs are then swapped    *
+ *              in bulk.  The last few blocks are finished as in invariant 1a     *
+ * @param   a      the array containing the segment to be partitioned             *
+ * @param   size   the size of array a                                            *
+ * @param   left   the index of the first array element in the partition          *
+ * @param   right  the index of the last array element in the partition           *
+ * @post    a[left] is moved to index mid, with left <= mid <= right              *
+ * @post    elements between left and right are permuted, so that                 *
+ *             a[left], ..., a[mid-1] <= a[mid]                                   *
+ *             a[mid+1], ..., a[right] >= a[mid]                                  *
+ * @post    elements outside left, ..., right are not changed                     *
+ * @returns mid                                                                   *
+ *********************************************************************************/
+#define blockSize 128
+
+int blockPartition (int a[ ], int size, int left, int right) {
+  int pivot = a[left];
+  int l_spot = left+1;   // a[left+1..l_spot-1] <= pivot
+  int r_spot = right;    // a[r_spot+1..right] >= pivot
+  unsigned char offsetsL [blockSize];
+  unsigned char offsetsR [blockSize];
+  int numL = 0, numR = 0, startL = 0, startR = 0;
+  int i;
+
+  while (r_spot - l_spot + 1 > 2 * blockSize) {
+    // record misplaced elements of the left block: those >= pivot
+    if (numL == 0) {
+      startL = 0;
+      for (i = 0; i < blockSize; i++) {
+        offsetsL[numL] = (unsigned char) i;
+        numL += opCompare (a[l_spot + i] >= pivot);
+      }
+    }
+    // record misplaced elements of the right block: those <= pivot
+    if (numR == 0) {
+      startR = 0;
+      for (i = 0; i < blockSize; i++) {
+        offsetsR[numR] = (unsigned char) i;
+        numR += opCompare (a[r_spot - i] <= pivot);
+      }
+    }
+
+    // swap as many misplaced pairs as both blocks provide
+    int num = (numL < numR) ? numL : numR;
+    for (i = 0; i < num; i++)
+      swap (&a[l_spot + offsetsL[startL + i]], &a[r_spot - offsetsR[startR + i]]);
+    numL -= num;
+    numR -= num;
+    startL += num;
+    startR += num;
+
+    // a block with no misplaced elements left is done
+    if (numL == 0)
+      l_spot += blockSize;
+    if (numR == 0)
+      r_spot -= blockSize;
+  }
+
+  // finish the remaining elements, including any partly used block,
+  // as in invariant 1a
+  while (l_spot <= r_spot) {
+    while( (l_spot <= r_spot) && opCompare (a[r_spot] >= pivot))
+      r_spot--;
+    while ((l_spot <= r_spot) && opCompare (a[l_spot] <= pivot))
+      l_spot++;
+
+    // if misplaced small and large values found, swap them
+    if (l_spot < r_spot) {
+      swap (&a[l_spot], &a[r_spot]);
+      l_spot++;
+      r_spot--;
+      }
+  }
+
+  // swap a[left] with biggest small value
+  swap (&a[left], &a[r_spot]);
+
+  return r_spot;
+}
+
+
+/** *******************************************************************************
+ * procedure implements the dual-pivot partition of Yaroslavskiy's quicksort      *
+ *    in brief: pivots p = a[left] and q = a[right] (swapped if p > q) split the  *
+ *              segment into small (< p), middle, and large (> q) elements,       *
+ *              scanned left to right with large elements swapped from the end    *
+ * @param   a      the array containing the segment to be partitioned             *
+ * @param   size   the size of array a                                            *
+ * @param   left   the index of the first array element in the partition          *
+ * @param   right  the index of the last array element in the partition           *
+ * @post    the original a[left] is moved to index mid, with left <= mid <= right *
+ * @post    elements between left and right are permuted, so that                 *
+ *             a[left], ..., a[mid-1] <= a[mid]                                   *
+ *             a[mid+1], ..., a[right] >= a[mid]                                  *
+ *          and the other pivot likewise separates the elements around it         *
+ * @post    elements outside left, ..., right are not changed                     *
+ * @returns mid                                                                   *
+ *********************************************************************************/
+int dualPivot (int a[ ], int size, int left, int right) {
+  if (left == right)
+    return left;
+
+  // the pivots must be in order; remember which one the caller's pivot became
+  int swapped = opCompare (a[left] > a[right]);
+  if (swapped)
+    swap (&a[left], &a[right]);
+  int p = a[left];
+  int q = a[right];
+  int l = left + 1;
+  int g = right - 1;
+  int k;
+
+  for (k = l; k <= g; k++) {
+    if (opCompare (a[k] < p)) {
+      swap (&a[k], &a[l]);
+      l++;
+    } else if (opCompare (a[k] > q)) {
+      while (opCompare (a[g] > q) && k < g)
+        g--;
+      swap (&a[k], &a[g]);
+      g--;
+      if (opCompare (a[k] < p)) {
+        swap (&a[k], &a[l]);
+        l++;
+      }
+    }
+  }
+  l--;
+  g++;
+
+  swap (&a[left], &a[l]);
+  swap (&a[right], &a[g]);
+
+  return swapped ? g : l;
+}
+
+/** *******************************************************************************
+ * procedure implements the three-pivot partition of Kushagra, Lopez-Ortiz, Qiao  *
+ *    and Munro, "Multi-Pivot Quicksort: Theory and Experiments", ALENEX 2014     *
+ *    in brief: a[left], a[left+1], a[right] are put in order as pivots p, q, r;  *
+ *              elements < q are scanned from the left and placed before or after *
+ *              p, elements > q are scanned from the right and placed before or   *
+ *              after r                                                           *
+ * @param   a      the array containing the segment to be partitioned             *
+ * @param   size   the size of array a                                            *
+ * @param   left   the index of the first array element in the partition          *
+ * @param   right  the index of the last array element in the partition           *
+ * @post    the original a[left] is moved to index mid, with left <= mid <= right *
+ * @post    elements between left and right are permuted, so that                 *
+ *             a[left], ..., a[mid-1] <= a[mid]                                   *
+ *             a[mid+1], ..., a[right] >= a[mid]                                  *
+ *          and the other pivots likewise separate the elements around them       *
+ * @post    elements outside left, ..., right are not changed                     *
+ * @returns mid                                                                   *
+ *********************************************************************************/
+int threePivot (int a[ ], int size, int left, int right) {
+  int pivot = a[left];
+
+  // too short for three pivots
+  if (right - left < 2) {
+    if (opCompare (a[left] > a[right])) {
+      swap (&a[left], &a[right]);
+      return right;
+    }
+    return left;
+  }
+
+  if (opCompare (a[left] > a[left + 1]))
+    swap (&a[left], &a[left + 1]);
+  if (opCompare (a[left + 1] > a[right]))
+    swap (&a[left + 1], &a[right]);
+  if (opCompare (a[left] > a[left + 1]))
+    swap (&a[left], &a[left + 1]);
+
+  int p = a[left];
+  int q = a[left + 1];
+  int r = a[right];
+  int i = left + 2;
+  int j = left + 2;
+  int k = right - 1;
+  int l = right - 1;
+
+  while (j <= k) {
+    while (opCompare (a[j] < q) && j <= k) {
+      if (opCompare (a[j] < p)) {
+        swap (&a[i], &a[j]);
+        i++;
+      }
+      j++;
+    }
+    while (opCompare (a[k] > q) && j <= k) {
+      if (opCompare (a[k] > r)) {
+        swap (&a[k], &a[l]);
+        l--;
+      }
+      k--;
+    }
+    if (j <= k) {
+      if (opCompare (a[j] > r)) {
+        if (opCompare (a[k] < p)) {
+          swap (&a[j], &a[i]);
+          swap (&a[i], &a[k]);
+          i++;
+        } else {
+          swap (&a[j], &a[k]);
+        }
+        swap (&a[k], &a[l]);
+        j++;
+        k--;
+        l--;
+      } else {
+        if (opCompare (a[k] < p)) {
+          swap (&a[j], &a[i]);
+          swap (&a[i], &a[k]);
+          i++;
+        } else {
+          swap (&a[j], &a[k]);
+        }
+        j++;
+        k--;
+      }
+    }
+  }
+  i--;
+  j--;
+  l++;
+
+  swap (&a[left + 1], &a[i]);
+  swap (&a[i], &a[j]);
+  i--;
+  swap (&a[left], &a[i]);
+  swap (&a[right], &a[l]);
+
+  // report whichever pivot holds the caller's pivot value
+  if (a[i] == pivot)
+    return i;
+  if (a[j] == pivot)
+    return j;
+  return l;
+}
+
+
+/** *******************************************************************************
+ * procedure implements a vectorized partition, using pivot a[left]               *
+ *    in brief: a[left+1..right] is split by the SIMD kernel into elements        *
+ *              <= pivot and > pivot, then the pivot is swapped to the boundary   *
+ * @param   a      the array containing the segment to be partitioned             *
+ * @param   size   the size of array a                                            *
+ * @param   left   the index of the first array element in the partition          *
+ * @param   right  the index of the last array element in the partition           *
+ * @post    a[left] is moved to index mid, with left <= mid <= right              *
+ * @post    elements between left and right are permuted, so that                 *
+ *             a[left], ..., a[mid-1] <= a[mid]                                   *
+ *             a[mid+1], ..., a[right] > a[mid]                                   *
+ * @post    elements outside left, ..., right are not changed                     *
+ * @returns mid                                                                   *
+ *********************************************************************************/
+int simdPartition (int a[ ], int size, int left, int right) {
+  partitionKernel kernel = selectPartitionKernel (NULL);
+  int mid = kernel (a, left+1, right+1, a[left]) - 1;
+
+  swap (&a[left], &a[mid]);
+  return mid;
+}
+
+
 /** *******************************************************************************
  * driver program for testing and timing partition algorithms                     *
  *********************************************************************************/
 
-int main ( ) {
+int main (int argc, char * argv [ ]) {
   // identify partition procedures used and their descriptive names
-  #define numAlgs  5
+  #define numAlgs  9
   partitionType procArray [numAlgs] = {{"invariant 1a ", invariant1a   },
                                        {"inv 1a w/swap", invariant1aSwap   },
                                        {"invariant 1b ", invariant1b   },
                                        {"invariant 2  ", invariant2},
-                                       {"invariant 3  ", invariant3}};
+                                       {"invariant 3  ", invariant3},
+                                       {"block partit.", blockPartition},
+                                       {"SIMD partit. ", simdPartition},
+                                       {"dual pivot   ", dualPivot},
+                                       {"three pivot  ", threePivot}};
 
   // print output headers
+  char * kernelName;
+  selectPartitionKernel (&kernelName);
   printf ("timing/testing of partition functions\n");
-  // print headings
-  printf ("               Data Set                             Times\n");
-  printf ("Algorithm        Size     Ascending Order       Random Order  Descending Order\n");
-
-  int size;
-  int reps;
-  int maxreps = 1000;
-
-  // organize data sets of increasing size for ascending, random, and descending data
-  for (size = 100000; size <= 1600000; size *= 2) {
-      // create control and initial data set arrays
-     int * asc = (int *) malloc (size * sizeof(int));   //array with ascending data
-     int * ran = (int *) malloc (size * sizeof(int));   //array with random data
-     int * des = (int *) malloc (size * sizeof(int));   // array with descending data
-
-     int i;
-     for (i = 0; i< size; i++) {
-        asc[i] = 2*i;
-        ran[i] = rand();
-        des[i] = 2*(size - i - 1);
-     }
-
-     // copy to test arrays
-     int * tempAsc = (int *) malloc (size * sizeof(int));
-     int * tempRan = (int *) malloc (size * sizeof(int));
-     int * tempDes = (int *) malloc (size * sizeof(int));
-
-     // repeat for each algorithm
-     for (int alg = 0; alg < numAlgs; alg++) {
-
-       // identify function and data set size
-       printf ("%s %7d", procArray[alg].name, size);
-        // timing variables
-       clock_t start_time, end_time;
-       double copy_time, elapsed_time;
-       int pivotSpot;
-
-       /* * * * * * * * * * * * * * * * * * * * * * * *
-        *      test and time algorithm:  algProc[alg] *
-        * * * * * * * * * * * * * * * * * * * * * * * */
-
-       /* * * * * * * test ascending data * * * * * * */
-
-       // determine average time to copy array
-       start_time = clock ();
-       for (reps = 0; reps < maxreps; reps++) {
-         for (i = 0; i< size; i++) {
-           tempAsc[i] = asc[i];
-         }
-       }
-       end_time = clock();
-       copy_time = ((end_time - start_time) / (double) CLOCKS_PER_SEC );
-       if (printCopyTime)
-         printf ("copy time:  %10.1lf\n", copy_time);
-
-       // timing for algorithm
-      start_time = clock ();
-      for (reps = 0; reps < maxreps; reps++) {
-        for (i = 0; i< size; i++) {
-          tempAsc[i] = asc[i];
-        }
-          pivotSpot = procArray[alg].proc (tempAsc, size, 0, size-1);
-      }
-       end_time = clock();
-       elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-       printf ("%13.1lf ", elapsed_time - copy_time);
-       printf ("%3s  ", checkPivotSpot (pivotSpot, 0, tempAsc, 0, size-1));
-
-       /* * * * * * * test random data * * * * * * */
-
-       // determine time to copy array
-       start_time = clock ();
-       for (reps = 0; reps < maxreps; reps++) {
-         for (i = 0; i< size; i++) {
-           tempRan[i] = ran[i];
-         }
-       }
-       end_time = clock();
-       copy_time = ((end_time - start_time) / (double) CLOCKS_PER_SEC );
-       if (printCopyTime)
-         printf ("copy time:  %10.1lf", copy_time);
-
-       // timing for algorithm
-       start_time = clock ();
-       for (reps = 0; reps < maxreps; reps++) {
-         for (i = 0; i< size; i++) {
-           tempRan[i] = ran[i];
-         }
-         pivotSpot = procArray[alg].proc (tempRan, size, 0, size-1);
-         }
-       end_time = clock();
-       elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-       printf ("%13.1lf ", elapsed_time - copy_time);
-       printf ("%3s ", checkPivotSpot (pivotSpot, ran[0], tempRan, 0, size-1));
-
-
-       /* * * * * * * test descending data * * * * * * */
-
-       // determine time to copy array
-       start_time = clock ();
-       for (reps = 0; reps < maxreps; reps++) {
-         for (i = 0; i< size; i++) {
-           tempDes[i] = des[i];
-         }
-       }
-       end_time = clock();
-       copy_time = ((end_time - start_time) / (double) CLOCKS_PER_SEC );
-       if (printCopyTime)
-         printf ("copy time:  %10.1lf", copy_time);
-
-       // timing for algoirthm
-       start_time = clock ();
-       for (reps = 0; reps < maxreps; reps++) {
-         for (i = 0; i< size; i++) {
-           tempDes[i] = des[i];
-         }
-         pivotSpot = procArray[alg].proc (tempDes, size, 0, size-1);
-       }
-       end_time = clock();
-       elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-       printf ("%13.1lf ", elapsed_time - copy_time);
-       printf ("%3s ", checkPivotSpot (pivotSpot, 2*(size - 1), tempDes, 0, size-1));
-
-       printf ("\n");
-
-     } // end of loop for testing an algorithm
-
-     // leave blank line before output of next size
-     printf ("\n");
-
-     // clean up copies of test arrays
-     free (tempAsc);
-     free (tempRan);
-     free (tempDes);
-
-     // clean up original test arrays
-     free (asc);
-     free (ran);
-     free (des);
-
-  } // end of loop for testing procedures with different array sizes
-
-  return 0;
+  printf ("SIMD partition kernel:  %s\n", kernelName);
+  // time every algorithm with the shared benchmark harness; a partition is
+  // quick, so it takes more trials than a sort for a steady median
+  benchInit (100000, 1600000, 2);
+  benchConf.trials = 25;
+  for (int alg = 0; alg < numAlgs; alg++)
+    benchAddPartition (procArray[alg].name, procArray[alg].proc)->counted = 1;
+
+  return benchRun (argc, argv);
 }
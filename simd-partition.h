@@ -0,0 +1,239 @@
+/** *******************************************************************************
+ * @remark SIMD partition kernels, shared by the partition and sorting programs   *
+ *                                                                                *
+ * @remark every kernel partitions a[lo..hi-1] about a pivot value; the scalar    *
+ *         kernel runs anywhere, the AVX2 and AVX-512 kernels on x86 processors   *
+ *         that have them.  selectPartitionKernel checks the processor once and   *
+ *         returns the widest kernel it supports                                  *
+ *                                                                                *
+ * @remark usage:                                                                 *
+ *         partitionKernel kernel = selectPartitionKernel (NULL);                 *
+ *         int mid = kernel (a, left+1, right+1, a[left]);                        *
+ *                                                                                *
+ * @file  simd-partition.h                                                        *
+ *                                                                                *
+ *********************************************************************************/
+
+#ifndef SIMD_PARTITION_H
+#define SIMD_PARTITION_H
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h> // for AVX2 and AVX-512 intrinsics
+#define haveX86Simd 1
+#else
+#define haveX86Simd 0
+#endif
+
+#include "benchmark.h" // for the operation counters
+
+/* every kernel partitions a[lo..hi-1] around pivot, elements <= pivot first,
+   and returns the index of the first element > pivot */
+typedef int (*partitionKernel) (int [ ], int, int, int);
+
+/** *******************************************************************************
+ * scalar partition kernel, used when the processor lacks AVX2                    *
+ * @param   a      the array containing the segment to be partitioned             *
+ * @param   lo     the index of the first element of the segment                  *
+ * @param   hi     one past the index of the last element of the segment          *
+ * @param   pivot  the value to partition around                                  *
+ * @post    a[lo..mid-1] <= pivot < a[mid..hi-1]                                  *
+ * @returns mid                                                                   *
+ *********************************************************************************/
+int scalarPartitionKernel (int a[ ], int lo, int hi, int pivot) {
+    int l_spot = lo;
+    int r_spot = hi - 1;
+
+    while (1) {
+        while ((l_spot <= r_spot) && opCompare (a[l_spot] <= pivot))
+            l_spot++;
+        while ((l_spot <= r_spot) && opCompare (a[r_spot] > pivot))
+            r_spot--;
+        if (l_spot >= r_spot)
+            break;
+        int temp = a[l_spot];
+        a[l_spot] = a[r_spot];
+        a[r_spot] = temp;
+        opSwap ();
+        l_spot++;
+        r_spot--;
+    }
+    return l_spot;
+}
+
+/** *******************************************************************************
+ * place the elements not handled by a vector loop                                *
+ * the caller has copied them to rest, so all of a[writeL..writeR-1] is free      *
+ * @param   a       the array being partitioned                                   *
+ * @param   rest    the remaining elements                                        *
+ * @param   num     the number of remaining elements, writeR - writeL             *
+ * @param   writeL  the next free slot for an element <= pivot                    *
+ * @param   writeR  one past the last free slot for an element > pivot            *
+ * @param   pivot   the value to partition around                                 *
+ * @returns the index of the first element > pivot                                *
+ *********************************************************************************/
+int finishPartition (int a[ ], int rest[ ], int num, int writeL, int writeR, int pivot) {
+    for (int i = 0; i < num; i++) {
+        if (opCompare (rest[i] <= pivot))
+            a[writeL++] = rest[i];
+        else
+            a[--writeR] = rest[i];
+    }
+    opWrites (num);
+    return writeL;
+}
+
+#if haveX86Simd
+/* compressPerm[mask] lists the lanes whose bit in mask is 0, then those whose bit is 1 */
+int compressPerm [256][8];
+
+/** *******************************************************************************
+ * AVX2 partition kernel, 8 elements per comparison, after B. Bramas,            *
+ *    "A Novel Hybrid Quicksort Algorithm Vectorized using AVX-512 on Intel       *
+ *    Skylake", 2017                                                              *
+ *    in brief: the first and last vectors are set aside, leaving 16 free slots.  *
+ *              Each step loads a vector from whichever end has fewer free slots, *
+ *              permutes it so small elements come first, and stores it both at  *
+ *              the left write point and ending at the right write point; the     *
+ *              extra lanes of each store land in free slots                      *
+ * @param   a      the array containing the segment to be partitioned             *
+ * @param   lo     the index of the first element of the segment                  *
+ * @param   hi     one past the index of the last element of the segment          *
+ * @param   pivot  the value to partition around                                  *
+ * @post    a[lo..mid-1] <= pivot < a[mid..hi-1]                                  *
+ * @returns mid                                                                   *
+ *********************************************************************************/
+__attribute__ ((target ("avx2,popcnt")))
+int avx2PartitionKernel (int a[ ], int lo, int hi, int pivot) {
+    if (hi - lo < 16)
+        return scalarPartitionKernel (a, lo, hi, pivot);
+
+    __m256i pivotVec = _mm256_set1_epi32 (pivot);
+    __m256i firstVec = _mm256_loadu_si256 ((__m256i *) (a + lo));
+    __m256i lastVec = _mm256_loadu_si256 ((__m256i *) (a + hi - 8));
+    int readL = lo + 8, readR = hi - 8;
+    int writeL = lo, writeR = hi;
+
+    while (readR - readL >= 8) {
+        __m256i v;
+        if (readL - writeL <= writeR - readR) {
+            v = _mm256_loadu_si256 ((__m256i *) (a + readL));
+            readL += 8;
+        } else {
+            readR -= 8;
+            v = _mm256_loadu_si256 ((__m256i *) (a + readR));
+        }
+        int mask = _mm256_movemask_ps (_mm256_castsi256_ps (_mm256_cmpgt_epi32 (v, pivotVec)));
+        int numLarge = _mm_popcnt_u32 (mask);
+        __m256i perm = _mm256_loadu_si256 ((__m256i *) compressPerm[mask]);
+        v = _mm256_permutevar8x32_epi32 (v, perm);
+        _mm256_storeu_si256 ((__m256i *) (a + writeL), v);
+        _mm256_storeu_si256 ((__m256i *) (a + writeR - 8), v);
+        opCompares (8);
+        opWrites (16);
+        writeL += 8 - numLarge;
+        writeR -= numLarge;
+    }
+
+    int rest [24];
+    int num = readR - readL;
+    for (int i = 0; i < num; i++)
+        rest[i] = a[readL + i];
+    _mm256_storeu_si256 ((__m256i *) (rest + num), firstVec);
+    _mm256_storeu_si256 ((__m256i *) (rest + num + 8), lastVec);
+    return finishPartition (a, rest, num + 16, writeL, writeR, pivot);
+}
+
+/** *******************************************************************************
+ * AVX-512 partition kernel, 16 elements per comparison                           *
+ *    same scheme as avx2PartitionKernel, with the permutation done by the        *
+ *    compress instruction                                                        *
+ * @param   a      the array containing the segment to be partitioned             *
+ * @param   lo     the index of the first element of the segment                  *
+ * @param   hi     one past the index of the last element of the segment          *
+ * @param   pivot  the value to partition around                                  *
+ * @post    a[lo..mid-1] <= pivot < a[mid..hi-1]                                  *
+ * @returns mid                                                                   *
+ *********************************************************************************/
+__attribute__ ((target ("avx512f,popcnt")))
+int avx512PartitionKernel (int a[ ], int lo, int hi, int pivot) {
+    if (hi - lo < 32)
+        return scalarPartitionKernel (a, lo, hi, pivot);
+
+    __m512i pivotVec = _mm512_set1_epi32 (pivot);
+    __m512i firstVec = _mm512_loadu_si512 (a + lo);
+    __m512i lastVec = _mm512_loadu_si512 (a + hi - 16);
+    int readL = lo + 16, readR = hi - 16;
+    int writeL = lo, writeR = hi;
+
+    while (readR - readL >= 16) {
+        __m512i v;
+        if (readL - writeL <= writeR - readR) {
+            v = _mm512_loadu_si512 (a + readL);
+            readL += 16;
+        } else {
+            readR -= 16;
+            v = _mm512_loadu_si512 (a + readR);
+        }
+        __mmask16 large = _mm512_cmpgt_epi32_mask (v, pivotVec);
+        int numLarge = _mm_popcnt_u32 (large);
+        _mm512_storeu_si512 (a + writeL, _mm512_maskz_compress_epi32 ((__mmask16) ~large, v));
+        // an unsigned mask, so numLarge == 0 shifts by 16 without overflow
+        __mmask16 upper = (__mmask16) (0xffffu << (16 - numLarge));
+        _mm512_storeu_si512 (a + writeR - 16,
+                             _mm512_maskz_expand_epi32 (upper,
+                                                        _mm512_maskz_compress_epi32 (large, v)));
+        opCompares (16);
+        opWrites (32);
+        writeL += 16 - numLarge;
+        writeR -= numLarge;
+    }
+
+    int rest [48];
+    int num = readR - readL;
+    for (int i = 0; i < num; i++)
+        rest[i] = a[readL + i];
+    _mm512_storeu_si512 (rest + num, firstVec);
+    _mm512_storeu_si512 (rest + num + 16, lastVec);
+    return finishPartition (a, rest, num + 32, writeL, writeR, pivot);
+}
+#endif
+
+/** *******************************************************************************
+ * choose the widest partition kernel the processor supports, checked once        *
+ * with CPUID through __builtin_cpu_supports                                      *
+ * @param   name  if not NULL, set to the name of the chosen kernel               *
+ * @returns the kernel                                                            *
+ *********************************************************************************/
+partitionKernel selectPartitionKernel (char ** name) {
+    static partitionKernel kernel = NULL;
+    static char * kernelName = "scalar";
+
+    if (kernel == NULL) {
+        kernel = scalarPartitionKernel;
+#if haveX86Simd
+        for (int mask = 0; mask < 256; mask++) {
+            int k = 0;
+            for (int lane = 0; lane < 8; lane++)
+                if (!(mask & (1 << lane)))
+                    compressPerm[mask][k++] = lane;
+            for (int lane = 0; lane < 8; lane++)
+                if (mask & (1 << lane))
+                    compressPerm[mask][k++] = lane;
+        }
+
+        __builtin_cpu_init ();
+        if (__builtin_cpu_supports ("avx512f")) {
+            kernel = avx512PartitionKernel;
+            kernelName = "AVX-512";
+        } else if (__builtin_cpu_supports ("avx2")) {
+            kernel = avx2PartitionKernel;
+            kernelName = "AVX2";
+        }
+#endif
+    }
+    if (name != NULL)
+        *name = kernelName;
+    return kernel;
+}
+
+#endif
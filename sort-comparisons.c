@@ -20,12 +20,34 @@
  * @remark People participating with Problem/Progra Discussions:                  *
  *         Marcia Watts                                                           *
  *                                                                                *
+ * @remark compile with:  gcc -O2 -pthread sort-comparisons.c                     *
+ *                                                                                *
  *********************************************************************************/
 
 #include <stdio.h>
 #include <stdbool.h>  // for bool
-#include <stdlib.h>   // for malloc, free, srand, rand
+#include <stdlib.h>   // for malloc, free, srand, rand, rand_r
 #include <time.h>     // for time
+#include <pthread.h>  // for threads of the parallel sorts
+#include <sched.h>    // for sched_yield
+#include <stdatomic.h>// for atomic_int
+#include <unistd.h>   // for sysconf, unlink
+#include <string.h>   // for memcpy, strcmp
+#include <limits.h>   // for INT_MAX
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, madvise
+#include <sys/stat.h> // for fstat, stat
+#include <signal.h>   // for signal, SIGXFSZ
+
+#include "benchmark.h" // shared timing harness
+
+#define parallelCutoff 16384  // subranges of at most this size are sorted sequentially
+#define maxWorkers     64     // upper bound on threads used by parallel sorts
+#define tileBytes  (256 * 1024)  // tiled merge sort: tile plus scratch fit in a 512KB L2
+#define mergeWays      16     // runs merged at once by each pass of the tiled merge sort
+#define heapArity       4     // children per node in the d-ary heap sort: 4 or 8
+#define externalMB    256     // default memory used by the external sort, in megabytes
+#define externalFanIn  64     // most runs merged at once by the external sort
 
 /** *******************************************************************************
  * structure to identify both the name of a sorting algorithm and                 *
@@ -38,6 +60,27 @@ typedef struct sorts {
     void (*sortProc) (int [ ], int); /**< the procedure name of a sorting function */
 } sorts;
 
+/** *******************************************************************************
+ * memory traffic of the last sort, for sorts that make full passes over the      *
+ * array: the number of passes and the bytes read plus written by each.  Sorts    *
+ * that do not report leave memoryPasses at 0                                     *
+ *********************************************************************************/
+int memoryPasses = 0;
+long long passBytes = 0;
+
+/** *******************************************************************************
+ * structure to identify a sorting algorithm for one element type,                *
+ * used by the typed sort driver, so the same algorithm may appear once per type  *
+ *********************************************************************************/
+typedef struct typedSorts {
+    char * name;                      /**< the name of a sorting algorithm as text    */
+    char * typeName;                  /**< the name of the element type as text       */
+    size_t elemSize;                  /**< bytes per element                          */
+    void (*sortProc) (void *, int);   /**< sorts n elements of the type               */
+    void (*fillProc) (void *, int);   /**< fills n elements with random values        */
+    char * (*checkProc) (void *, int);/**< "ok" if n elements are in order, else "NO" */
+} typedSorts;
+
 /* * * * * * * * * * sorting procedures, with helper, as needed  * * * * * * * * */
 
 /** *******************************************************************************
@@ -55,13 +98,14 @@ void selectionSort (int a [ ], int n) {
         // find largest in a[i..n-1]
         smallIndex = i;
         for (j = i-1; j >= 0; j--) {
-            if (a[smallIndex] < a[j])
+            if (opCompare (a[smallIndex] < a[j]))
                 smallIndex = j;
         }
         // swap smallest to a[i]
         temp = a[smallIndex];
         a[smallIndex] = a[i];
         a[i] = temp;
+        opSwap ();
     }
 }
 
@@ -78,11 +122,13 @@ void insertionSort (int a [], int n) {
     for (int k = 1; k < n; k++) {
         int item = a[k];
         int i = k-1;
-        while ((i >= 0) && a[i] > item){
+        while ((i >= 0) && opCompare (a[i] > item)){
             a[i+1] = a[i];
+            opWrite ();
             i--;
         }
         a[i+1] = item;
+        opWrite ();
     }
 }
 
@@ -91,16 +137,18 @@ void insertionSort (int a [], int n) {
  * Quicksort helper function                                                      *
  * uses a[left] as pivot value in processing                                      *
  * @param  a  the array to be processed                                           *
- * @param  size  the size of the array                                            *
  * @param  left:  the lower index for items to be processed                       *
  * @param  right  the upper index for items to be processed                       *
+ * @param  seed  random number state for rand_r, as each thread of the parallel   *
+ *               quicksort keeps its own; NULL draws the pivot from rand()        *
  * @post   elements of a are rearranged, so that                                  *
  *             items between left and index mid are <= a[mid]                     *
  *             items between dex mid and right are >= a[mid]                      *
  * @returns  mid                                                                  *
  *********************************************************************************/
-int partition (int a[ ], int size, int left, int right) {
-    int pivotIndex = left + (rand() % (right-left+1));
+int seededPartition (int a[ ], int left, int right, unsigned int * seed) {
+    int draw = (seed != NULL) ? rand_r (seed) : rand ();
+    int pivotIndex = left + (draw % (right-left+1));
     int pivot = a[pivotIndex];
     int l_spot = left+1;
     int r_spot = right;
@@ -110,11 +158,12 @@ int partition (int a[ ], int size, int left, int right) {
     temp = a[left];
     a[left] = a[pivotIndex];
     a[pivotIndex] = temp;
+    opSwap ();
 
     while (l_spot <= r_spot) {
-        while( (l_spot <= r_spot) && (a[r_spot] >= pivot))
+        while( (l_spot <= r_spot) && opCompare (a[r_spot] >= pivot))
             r_spot--;
-        while ((l_spot <= r_spot) && (a[l_spot] <= pivot))
+        while ((l_spot <= r_spot) && opCompare (a[l_spot] <= pivot))
             l_spot++;
 
         // if misplaced small and large values found, swap them
@@ -122,6 +171,7 @@ int partition (int a[ ], int size, int left, int right) {
             temp = a[l_spot];
             a[l_spot] = a[r_spot];
             a[r_spot] = temp;
+            opSwap ();
             l_spot++;
             r_spot--;
         }
@@ -131,9 +181,15 @@ int partition (int a[ ], int size, int left, int right) {
     temp = a[left];
     a[left] = a[r_spot];
     a[r_spot] = temp;
+    opSwap ();
     return r_spot;
 }
 
+/* partition with a pivot drawn from rand(), for the sequential quicksorts */
+int partition (int a[ ], int size, int left, int right) {
+    return seededPartition (a, left, right, NULL);
+}
+
 /** *******************************************************************************
  * Quicksort helper function                                                      *
  * @param  a  the array to be processed                                           *
@@ -151,7 +207,7 @@ void quicksorthelper (int a [ ], int size, int left, int right) {
 
     // use insertion sort for the defined threshold of array segments
     if ((right - left) <= hybridThreshold) {
-        insertionSort(a, size);
+        insertionSort(a + left, right - left + 1);
     }
     else {
         int mid = partition(a, size, left, right);
@@ -194,11 +250,12 @@ int impPartition (int a[ ], int size, int left, int right) {
     temp = a[left];
     a[left] = a[pivotIndex];
     a[pivotIndex] = temp;
+    opSwap ();
 
     while (l_spot <= r_spot) {
-        while( (l_spot <= r_spot) && (a[r_spot] >= pivot))
+        while( (l_spot <= r_spot) && opCompare (a[r_spot] >= pivot))
             r_spot--;
-        while ((l_spot <= r_spot) && (a[l_spot] <= pivot))
+        while ((l_spot <= r_spot) && opCompare (a[l_spot] <= pivot))
             l_spot++;
 
         // if misplaced small and large values found, swap them
@@ -206,6 +263,7 @@ int impPartition (int a[ ], int size, int left, int right) {
             temp = a[l_spot];
             a[l_spot] = a[r_spot];
             a[r_spot] = temp;
+            opSwap ();
             l_spot++;
             r_spot--;
         }
@@ -215,6 +273,7 @@ int impPartition (int a[ ], int size, int left, int right) {
     temp = a[left];
     a[left] = a[r_spot];
     a[r_spot] = temp;
+    opSwap ();
     return r_spot;
 }
 
@@ -245,6 +304,226 @@ void impQuicksort (int a [ ], int n) {
 
 }
 
+/* * * * * * * parallel quicksort, work-stealing pool and helpers * * * * * * */
+
+/** *******************************************************************************
+ * structure for one unit of parallel quicksort work: the subrange a[left..right] *
+ *********************************************************************************/
+typedef struct qsTask {
+    int left;   /**< the lower index for items to be sorted  */
+    int right;  /**< the upper index for items to be sorted  */
+} qsTask;
+
+/** *******************************************************************************
+ * double-ended queue of tasks owned by one worker                                *
+ * the owner pushes and pops at the bottom (newest task),                         *
+ * idle workers steal from the top (oldest and typically largest task)            *
+ *********************************************************************************/
+typedef struct qsDeque {
+    pthread_mutex_t lock;  /**< guards all fields below                 */
+    qsTask * tasks;        /**< storage for queued tasks                */
+    int top;               /**< index of the oldest task                */
+    int bottom;            /**< one past the index of the newest task   */
+    int capacity;          /**< number of tasks storage can hold        */
+} qsDeque;
+
+/** *******************************************************************************
+ * state shared by all workers of one parallel quicksort call                     *
+ *********************************************************************************/
+typedef struct qsPool {
+    int * a;                       /**< the array being sorted                     */
+    int numWorkers;                /**< number of workers, including the caller    */
+    qsDeque deques [maxWorkers];   /**< one task queue per worker                  */
+    atomic_int pending;            /**< tasks queued or running, 0 when sort done  */
+} qsPool;
+
+/** *******************************************************************************
+ * per-thread state of a parallel quicksort worker                                *
+ *********************************************************************************/
+typedef struct qsWorker {
+    qsPool * pool;      /**< the pool the worker belongs to                 */
+    int id;             /**< index of the worker's own deque                */
+    unsigned int seed;  /**< private rand_r state, so pivots need no lock   */
+} qsWorker;
+
+/** *******************************************************************************
+ * add a task at the bottom of a deque, growing its storage as needed             *
+ * @param  dq    the deque                                                        *
+ * @param  task  the task to be added                                             *
+ *********************************************************************************/
+void qsPush (qsDeque * dq, qsTask task) {
+    pthread_mutex_lock (&dq->lock);
+    if (dq->bottom == dq->capacity) {
+        if (dq->top > 0) {
+            // reclaim the space left behind by stolen tasks
+            for (int i = dq->top; i < dq->bottom; i++)
+                dq->tasks[i - dq->top] = dq->tasks[i];
+            dq->bottom -= dq->top;
+            dq->top = 0;
+        } else {
+            dq->capacity *= 2;
+            dq->tasks = (qsTask *) realloc (dq->tasks, dq->capacity * sizeof(qsTask));
+        }
+    }
+    dq->tasks[dq->bottom++] = task;
+    pthread_mutex_unlock (&dq->lock);
+}
+
+/** *******************************************************************************
+ * remove a task from a deque                                                     *
+ * @param  dq       the deque                                                     *
+ * @param  task     location to store the removed task                            *
+ * @param  fromTop  true to take the oldest task (steal), false for the newest    *
+ * @returns  true if a task was removed; false if the deque was empty             *
+ *********************************************************************************/
+bool qsTake (qsDeque * dq, qsTask * task, bool fromTop) {
+    bool found = false;
+    pthread_mutex_lock (&dq->lock);
+    if (dq->top < dq->bottom) {
+        *task = fromTop ? dq->tasks[dq->top++] : dq->tasks[--dq->bottom];
+        if (dq->top == dq->bottom)
+            dq->top = dq->bottom = 0;
+        found = true;
+    }
+    pthread_mutex_unlock (&dq->lock);
+    return found;
+}
+
+/** *******************************************************************************
+ * sequential quicksort of a subrange, used below the parallel cutoff             *
+ * recurses on the smaller side and loops on the larger, so stack depth           *
+ * stays O(log n); short segments finish with insertion sort                      *
+ * @param  a     the array to be processed                                        *
+ * @param  left  the lower index for items to be processed                        *
+ * @param  right the upper index for items to be processed                        *
+ * @param  seed  the calling thread's random number state                         *
+ * @post  sorts elements of a between left and right                              *
+ *********************************************************************************/
+void parQuicksortSeq (int a [ ], int left, int right, unsigned int * seed) {
+    while (right - left > 9) {
+        int mid = seededPartition (a, left, right, seed);
+        if (mid - left < right - mid) {
+            parQuicksortSeq (a, left, mid - 1, seed);
+            left = mid + 1;
+        } else {
+            parQuicksortSeq (a, mid + 1, right, seed);
+            right = mid - 1;
+        }
+    }
+    if (left < right)
+        insertionSort (a + left, right - left + 1);
+}
+
+/** *******************************************************************************
+ * process one parallel quicksort task                                            *
+ * while the range is above the cutoff, partition it, queue the larger side       *
+ * for this or any idle worker, and keep splitting the smaller side               *
+ * @param  w     the worker running the task                                      *
+ * @param  task  the subrange to be sorted                                        *
+ * @post  the subrange is sorted, or split into queued subtasks                   *
+ *********************************************************************************/
+void parQuicksortTask (qsWorker * w, qsTask task) {
+    qsPool * pool = w->pool;
+    int left = task.left;
+    int right = task.right;
+
+    while (right - left + 1 > parallelCutoff) {
+        int mid = seededPartition (pool->a, left, right, &w->seed);
+        qsTask larger;
+        if (mid - left < right - mid) {
+            larger.left = mid + 1;
+            larger.right = right;
+            right = mid - 1;
+        } else {
+            larger.left = left;
+            larger.right = mid - 1;
+            left = mid + 1;
+        }
+        atomic_fetch_add (&pool->pending, 1);
+        qsPush (&pool->deques[w->id], larger);
+    }
+    parQuicksortSeq (pool->a, left, right, &w->seed);
+}
+
+/** *******************************************************************************
+ * worker loop: run own tasks newest first, otherwise steal the oldest task       *
+ * of another worker, until no task is queued or running anywhere                 *
+ * @param  arg  the qsWorker for this thread                                      *
+ *********************************************************************************/
+void * parQuicksortWorker (void * arg) {
+    qsWorker * w = (qsWorker *) arg;
+    qsPool * pool = w->pool;
+    qsTask task;
+
+    while (atomic_load (&pool->pending) > 0) {
+        bool found = qsTake (&pool->deques[w->id], &task, false);
+        // pick victims starting at a random worker, to spread out contention
+        int start = rand_r (&w->seed) % pool->numWorkers;
+        for (int v = 0; !found && v < pool->numWorkers; v++) {
+            int victim = (start + v) % pool->numWorkers;
+            if (victim != w->id)
+                found = qsTake (&pool->deques[victim], &task, true);
+        }
+
+        if (found) {
+            parQuicksortTask (w, task);
+            atomic_fetch_sub (&pool->pending, 1);
+        } else {
+            sched_yield ();
+        }
+    }
+    return NULL;
+}
+
+/** *******************************************************************************
+ * parallel quicksort, main function                                              *
+ * one worker per online processor, the calling thread being worker 0             *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void parQuicksort (int a [ ], int n) {
+    long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+    int numWorkers = (cpus < 1) ? 1 : (cpus > maxWorkers) ? maxWorkers : (int) cpus;
+    unsigned int seed = (unsigned int) rand ();
+
+    if (numWorkers == 1 || n <= parallelCutoff) {
+        parQuicksortSeq (a, 0, n-1, &seed);
+        return;
+    }
+
+    qsPool pool;
+    pool.a = a;
+    pool.numWorkers = numWorkers;
+    atomic_init (&pool.pending, 1);
+    for (int i = 0; i < numWorkers; i++) {
+        pthread_mutex_init (&pool.deques[i].lock, NULL);
+        pool.deques[i].capacity = 64;
+        pool.deques[i].tasks = (qsTask *) malloc (64 * sizeof(qsTask));
+        pool.deques[i].top = pool.deques[i].bottom = 0;
+    }
+    qsTask whole = {0, n-1};
+    qsPush (&pool.deques[0], whole);
+
+    qsWorker workers [maxWorkers];
+    pthread_t threads [maxWorkers];
+    for (int i = 0; i < numWorkers; i++) {
+        workers[i].pool = &pool;
+        workers[i].id = i;
+        workers[i].seed = seed + 7919 * i;
+    }
+    for (int i = 1; i < numWorkers; i++)
+        pthread_create (&threads[i], NULL, parQuicksortWorker, &workers[i]);
+    parQuicksortWorker (&workers[0]);
+    for (int i = 1; i < numWorkers; i++)
+        pthread_join (threads[i], NULL);
+
+    for (int i = 0; i < numWorkers; i++) {
+        pthread_mutex_destroy (&pool.deques[i].lock);
+        free (pool.deques[i].tasks);
+    }
+}
+
 /* * * * * * * *  merge sort and helper functions * * * * * * * * */
 /** *******************************************************************************
  * merge sort helper function                                                     *
@@ -266,7 +545,7 @@ void merge (int aInit [ ], int aRes [ ], int aInitLength, int start1, int start2
 
     //Get the smallest element and then increment that side
     while ((start1 < oldStart2) && (start2 < end2 && start2 < aInitLength)) {
-        if (aInit[start1] <= aInit[start2]) {
+        if (opCompare (aInit[start1] <= aInit[start2])) {
             aRes[newArrayPtr] = aInit[start1];
             start1++;
             newArrayPtr++;
@@ -275,16 +554,19 @@ void merge (int aInit [ ], int aRes [ ], int aInitLength, int start1, int start2
             start2++;
             newArrayPtr++;
         }
+        opWrite ();
     }
     //extra element in left array
     while(start1 < oldStart2 && start1 < aInitLength) {
         aRes[newArrayPtr] = aInit[start1];
+        opWrite ();
         start1++;
         newArrayPtr++;
     }
     //extra element in right array
     while(start2 < end2 && start2 < aInitLength) {
         aRes[newArrayPtr] = aInit[start2];
+        opWrite ();
         start2++;
         newArrayPtr++;
     }
@@ -301,6 +583,7 @@ void mergeSort (int initArr [ ], int n) {
     int * a0 = initArr;
     int * a1 = resArr;
     bool needCopyBack = false;
+    memoryPasses = 0;
 
     int mergeSize = 1;
     int start1;
@@ -320,17 +603,381 @@ void mergeSort (int initArr [ ], int n) {
 
         // keep track of which array holds initArr object
         needCopyBack = !needCopyBack;
+        memoryPasses++;
     }
 
     //copy result into initArr, as needed
     if (needCopyBack) {
         for (int i = 0; i < n; i++)
             initArr [i] = a0 [i];
+        opWrites (n);
+        memoryPasses++;
     }
+    passBytes = 2LL * n * sizeof(int);
 
     free (resArr);
 }
 
+/* * * * * * * * * * * tiled merge sort and helper functions * * * * * * * * * * */
+
+/** *******************************************************************************
+ * sort one tile with bottom-up merges between the tile and a scratch array of    *
+ * the same size, both small enough to stay in cache                              *
+ * @param  tile  the elements to be sorted                                        *
+ * @param  scratch  room for n elements                                           *
+ * @param  n  the size of the tile                                                *
+ * @post  the tile is sorted in non-descending order                              *
+ *********************************************************************************/
+void sortTile (int tile [ ], int scratch [ ], int n) {
+    int * a0 = tile;
+    int * a1 = scratch;
+
+    for (int mergeSize = 1; mergeSize < n; mergeSize *= 2) {
+        int end2;
+        for (int start1 = 0; start1 < n; start1 = end2) {
+            int start2 = start1 + mergeSize;
+            end2 = start2 + mergeSize;
+            merge (a0, a1, n, start1, start2, end2);
+        }
+        int * temp = a0;
+        a0 = a1;
+        a1 = temp;
+    }
+    if (a0 != tile) {
+        memcpy (tile, a0, n * sizeof(int));
+        opWrites (n);
+    }
+}
+
+/** *******************************************************************************
+ * loser tree comparison: does run i supply the next element ahead of run j       *
+ * @remark  an exhausted run has key INT_MAX and done set, so it loses to every   *
+ *          other run; equal keys are taken from the earlier run first, so the    *
+ *          merge is stable                                                       *
+ *********************************************************************************/
+bool loserBeats (int key [ ], bool done [ ], int i, int j) {
+    if (opCompare (key[i] != key[j]))
+        return key[i] < key[j];
+    return !done[i] && (done[j] || i < j);
+}
+
+/** *******************************************************************************
+ * merge up to mergeWays sorted runs with a loser tree                            *
+ * @param  src  the array holding the runs                                        *
+ * @param  dst  the array receiving the merged result, at the same positions      *
+ * @param  start  the first index of the first run                                *
+ * @param  runLength  the length of each run, the last possibly shorter           *
+ * @param  k  the number of runs                                                  *
+ * @param  n  the size of src; runs end at n at the latest                        *
+ * @post  dst[start..] holds the k runs merged, in non-descending order           *
+ *********************************************************************************/
+void loserTreeMerge (int src [ ], int dst [ ], int start, int runLength, int k, int n) {
+    int cur [mergeWays];
+    int end [mergeWays];
+    int key [mergeWays];           // the next element of each run
+    bool done [mergeWays];         // whether each run is exhausted
+    int tree [mergeWays];          // tree[0] is the winner, tree[1..] losers
+    int winner [2 * mergeWays];
+
+    // leaves are padded to a power of two with empty runs
+    int leaves = 1;
+    while (leaves < k)
+        leaves *= 2;
+    for (int r = 0; r < leaves; r++) {
+        long long runStart = start + (long long) r * runLength;
+        cur[r] = (r < k && runStart < n) ? (int) runStart : n;
+        end[r] = (r < k && runStart + runLength < n) ? (int) (runStart + runLength) : n;
+        done[r] = cur[r] >= end[r];
+        key[r] = done[r] ? INT_MAX : src[cur[r]];
+    }
+
+    // play the initial tournament, keeping the loser of each match
+    for (int r = 0; r < leaves; r++)
+        winner[leaves + r] = r;
+    for (int node = leaves - 1; node >= 1; node--) {
+        int left = winner[2*node];
+        int right = winner[2*node + 1];
+        if (loserBeats (key, done, left, right)) {
+            winner[node] = left;
+            tree[node] = right;
+        } else {
+            winner[node] = right;
+            tree[node] = left;
+        }
+    }
+    tree[0] = winner[1];
+
+    // output the winner, then replay its path to the root
+    int total = end[k-1] - start;
+    int out = start;
+    for (int count = 0; count < total; count++) {
+        int w = tree[0];
+        dst[out++] = key[w];
+        if (++cur[w] < end[w])
+            key[w] = src[cur[w]];
+        else {
+            key[w] = INT_MAX;
+            done[w] = true;
+        }
+        for (int node = (w + leaves) / 2; node >= 1; node /= 2) {
+            if (loserBeats (key, done, tree[node], w)) {
+                int temp = tree[node];
+                tree[node] = w;
+                w = temp;
+            }
+        }
+        tree[0] = w;
+    }
+    opWrites (total);
+}
+
+/** *******************************************************************************
+ * cache-aware merge sort: sorts tiles of tileBytes entirely in cache, then       *
+ * merges mergeWays runs at a time with a loser tree, so the array makes only     *
+ * 1 + log_mergeWays(n / tile size) trips through memory rather than log2 n       *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void tiledMergeSort (int a [ ], int n) {
+    int tileSize = tileBytes / sizeof(int);
+
+    // count merge passes, so the tiles go to whichever array leaves
+    // the final pass writing into a
+    int mergePasses = 0;
+    for (long long runs = (n + tileSize - 1) / tileSize; runs > 1;
+         runs = (runs + mergeWays - 1) / mergeWays)
+        mergePasses++;
+
+    int * other = (int *) malloc (n * sizeof(int));
+    int * scratch = (int *) malloc (tileSize * sizeof(int));
+    int * src = (mergePasses % 2 == 0) ? a : other;
+    int * dst = (src == a) ? other : a;
+
+    for (int start = 0; start < n; start += tileSize) {
+        int length = (n - start < tileSize) ? n - start : tileSize;
+        sortTile (a + start, scratch, length);
+        if (src != a) {
+            memcpy (src + start, a + start, length * sizeof(int));
+            opWrites (length);
+        }
+    }
+
+    long long runLength = tileSize;
+    for (int pass = 0; pass < mergePasses; pass++) {
+        long long groupLength = runLength * mergeWays;
+        for (long long start = 0; start < n; start += groupLength) {
+            int k = (int) ((n - start + runLength - 1) / runLength);
+            if (k > mergeWays)
+                k = mergeWays;
+            loserTreeMerge (src, dst, (int) start, (int) runLength, k, n);
+        }
+        int * temp = src;
+        src = dst;
+        dst = temp;
+        runLength = groupLength;
+    }
+
+    memoryPasses = 1 + mergePasses;
+    passBytes = 2LL * n * sizeof(int);
+    free (other);
+    free (scratch);
+}
+
+/* * * * * * * parallel merge sort and helper functions * * * * * * * */
+
+/** *******************************************************************************
+ * state shared by the threads of one parallel merge sort call                    *
+ * thread t owns output positions chunkStart(t) .. chunkStart(t+1)-1 in every     *
+ * pass, so each pass is divided evenly across threads                            *
+ *********************************************************************************/
+typedef struct pmsShared {
+    int * a0;                    /**< array holding the input of the first pass  */
+    int * a1;                    /**< scratch array of the same size             */
+    int n;                       /**< the size of the arrays                     */
+    int numThreads;              /**< number of threads sorting                  */
+    pthread_barrier_t barrier;   /**< separates the merge passes                 */
+} pmsShared;
+
+/** *******************************************************************************
+ * per-thread state of a parallel merge sort                                      *
+ *********************************************************************************/
+typedef struct pmsWorker {
+    pmsShared * shared;  /**< data shared by all threads      */
+    int id;              /**< the chunk this thread owns      */
+} pmsWorker;
+
+/** *******************************************************************************
+ * first index of a chunk when n items are split into numThreads chunks           *
+ * @param  n           the number of items                                        *
+ * @param  numThreads  the number of chunks                                       *
+ * @param  t           the chunk, 0 <= t <= numThreads                            *
+ * @returns  the index where chunk t begins (n when t == numThreads)              *
+ *********************************************************************************/
+int chunkStart (int n, int numThreads, int t) {
+    return (int) ((long long) n * t / numThreads);
+}
+
+/** *******************************************************************************
+ * co-ranking step of the merge path                                              *
+ * finds how many of the first k items of the stable merge of                     *
+ * a[0..m-1] and b[0..nb-1] come from a                                           *
+ * @param  k   the number of merged items, 0 <= k <= m + nb                       *
+ * @param  a   the first sorted segment                                           *
+ * @param  m   the size of a                                                      *
+ * @param  b   the second sorted segment                                          *
+ * @param  nb  the size of b                                                      *
+ * @returns  i, so the first k merged items are a[0..i-1] and b[0..k-i-1]         *
+ *********************************************************************************/
+int coRank (int k, int a [ ], int m, int b [ ], int nb) {
+    int low = (k > nb) ? k - nb : 0;
+    int high = (k < m) ? k : m;
+
+    while (low < high) {
+        int i = low + (high - low) / 2;
+        int j = k - i;
+        // a[i] belongs among the first k when it does not exceed b[j-1]
+        if (j > 0 && opCompare (a[i] <= b[j-1]))
+            low = i + 1;
+        else
+            high = i;
+    }
+    return low;
+}
+
+/** *******************************************************************************
+ * merge two sorted segments of src into dst, starting at index out               *
+ * @param  src   source array for merging                                         *
+ * @param  dst   target array for merging                                         *
+ * @param  i     first index of the first segment                                 *
+ * @param  iEnd  one past the last index of the first segment                     *
+ * @param  j     first index of the second segment                                *
+ * @param  jEnd  one past the last index of the second segment                    *
+ * @param  out   index in dst receiving the smallest merged item                  *
+ * @post  dst[out..] holds the stable merge of the two segments                   *
+ *********************************************************************************/
+void mergeRanges (int src [ ], int dst [ ], int i, int iEnd, int j, int jEnd, int out) {
+    opWrites ((iEnd - i) + (jEnd - j));
+    while (i < iEnd && j < jEnd) {
+        if (opCompare (src[i] <= src[j]))
+            dst[out++] = src[i++];
+        else
+            dst[out++] = src[j++];
+    }
+    while (i < iEnd)
+        dst[out++] = src[i++];
+    while (j < jEnd)
+        dst[out++] = src[j++];
+}
+
+/** *******************************************************************************
+ * parallel merge sort, work of one thread                                        *
+ * phase 1 sorts the thread's own chunk with the bottom-up passes of mergeSort;   *
+ * phase 2 merges pairs of sorted runs, each thread producing its own slice of    *
+ * the output, located with coRank                                                *
+ * @param  arg  the pmsWorker for this thread                                     *
+ *********************************************************************************/
+void * parMergeSortWorker (void * arg) {
+    pmsWorker * w = (pmsWorker *) arg;
+    pmsShared * sh = w->shared;
+    int n = sh->n;
+    int t = sh->numThreads;
+    int * a0 = sh->a0;
+    int * a1 = sh->a1;
+    int lo = chunkStart (n, t, w->id);
+    int hi = chunkStart (n, t, w->id + 1);
+
+    // all threads make the same number of passes, so they agree on which
+    // array holds the sorted chunks; a merge with mergeSize >= chunk copies
+    int maxChunk = chunkStart (n, t, 1);
+    for (int id = 1; id < t; id++) {
+        int len = chunkStart (n, t, id + 1) - chunkStart (n, t, id);
+        if (len > maxChunk)
+            maxChunk = len;
+    }
+
+    for (int mergeSize = 1; mergeSize < maxChunk; mergeSize *= 2) {
+        int end2;
+        for (int start1 = lo; start1 < hi; start1 = end2) {
+            int start2 = start1 + mergeSize;
+            end2 = start2 + mergeSize;
+            merge (a0, a1, hi, start1, start2, end2);
+        }
+        int * temp = a0;
+        a0 = a1;
+        a1 = temp;
+    }
+    pthread_barrier_wait (&sh->barrier);
+
+    // width counts chunks per sorted run
+    for (int width = 1; width < t; width *= 2) {
+        int group = w->id / (2 * width) * (2 * width);
+        int mid = (group + width < t) ? group + width : t;
+        int end = (group + 2 * width < t) ? group + 2 * width : t;
+        int aStart = chunkStart (n, t, group);
+        int bStart = chunkStart (n, t, mid);
+        int bEnd = chunkStart (n, t, end);
+
+        int i0 = coRank (lo - aStart, a0 + aStart, bStart - aStart, a0 + bStart, bEnd - bStart);
+        int i1 = coRank (hi - aStart, a0 + aStart, bStart - aStart, a0 + bStart, bEnd - bStart);
+        int j0 = (lo - aStart) - i0;
+        int j1 = (hi - aStart) - i1;
+        mergeRanges (a0, a1, aStart + i0, aStart + i1, bStart + j0, bStart + j1, lo);
+
+        pthread_barrier_wait (&sh->barrier);
+        int * temp = a0;
+        a0 = a1;
+        a1 = temp;
+    }
+
+    // copy this thread's slice back, if the result ended up in the scratch array
+    if (a0 != sh->a0) {
+        for (int i = lo; i < hi; i++)
+            sh->a0[i] = a0[i];
+        opWrites (hi - lo);
+    }
+    return NULL;
+}
+
+/** *******************************************************************************
+ * parallel merge sort, main function                                             *
+ * one thread per online processor, the calling thread being thread 0             *
+ * @param  initArr  the array to be sorted                                        *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void parMergeSort (int initArr [ ], int n) {
+    long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+    int numThreads = (cpus < 1) ? 1 : (cpus > maxWorkers) ? maxWorkers : (int) cpus;
+
+    if (numThreads == 1 || n <= parallelCutoff) {
+        mergeSort (initArr, n);
+        return;
+    }
+
+    pmsShared shared;
+    shared.a0 = initArr;
+    shared.a1 = (int *) malloc (n * sizeof(int));
+    shared.n = n;
+    shared.numThreads = numThreads;
+    pthread_barrier_init (&shared.barrier, NULL, numThreads);
+
+    pmsWorker workers [maxWorkers];
+    pthread_t threads [maxWorkers];
+    for (int i = 0; i < numThreads; i++) {
+        workers[i].shared = &shared;
+        workers[i].id = i;
+    }
+    for (int i = 1; i < numThreads; i++)
+        pthread_create (&threads[i], NULL, parMergeSortWorker, &workers[i]);
+    parMergeSortWorker (&workers[0]);
+    for (int i = 1; i < numThreads; i++)
+        pthread_join (threads[i], NULL);
+
+    pthread_barrier_destroy (&shared.barrier);
+    free (shared.a1);
+}
+
 /* * * * * * * * heap sort and helper functions * * * * * * * * */
 /** *******************************************************************************
  * heap sort, helper function                                                     *
@@ -345,10 +992,10 @@ void percDown(int array [ ], int hole, int size) {
     int left = 2 * hole + 1;
     int right = 2 * hole + 2;
 
-    if (left < size && array[left] > array[large]) {
+    if (left < size && opCompare (array[left] > array[large])) {
         large = left;
     }
-    if (right < size && array[right] > array[large]) {
+    if (right < size && opCompare (array[right] > array[large])) {
         large = right;
     }
 
@@ -356,6 +1003,7 @@ void percDown(int array [ ], int hole, int size) {
         int temp = array[hole];
         array[hole] = array[large];
         array[large] = temp;
+        opSwap ();
         percDown(array, large, size);
     }
 }
@@ -376,162 +1024,2307 @@ void heapSort (int a [ ], int n) {
         int tmp = a[0];
         a[0] = a[i];
         a[i] = tmp   ; // deleteMax
+        opSwap ();
         percDown( a, 0, i); // Maintain heap ordering property
     }
 }
 
-/* * * * * * * * * * * * procedures to check sorting correctness  * * * * * * * * */
-
+/* * * * * * * * * * * d-ary heap sort and helper functions * * * * * * * * * * */
 
 /** *******************************************************************************
- * check all array elements have values 0, 2, 4, . . ., 2(n-1)                    *
- * @param  a  the array to be sorted                                              *
- * @param  n  the size of the array                                               *
- * returns  "ok" if array contains required elements; "NO" if not                 *
+ * d-ary heap sort, helper function: bottom-up (Floyd) sift down                  *
+ * @remark  the hole at the top runs down to a leaf along the largest children,   *
+ *          with no comparison against the sifted element, which then rises       *
+ *          from the leaf to its place; it rarely rises far, so this saves        *
+ *          nearly one comparison per level.  The children of node i are          *
+ *          heapArity*i+1 .. heapArity*i+heapArity, one contiguous group, and     *
+ *          the grandchildren, one heapArity^2 block, are prefetched a level      *
+ *          ahead.  The array is the caller's, so whether a group shares one      *
+ *          cache line depends on its alignment                                   *
+ * @param  array  the array to be sorted                                          *
+ * @param  hole  index of element to be worked downward in array to give heap     *
+ * @param  size the overall size of the array                                     *
+ * @pre  subtrees under the hole index are heaps                                  *
+ * @post the entire subtree, starting from the original tree, is a heap           *
  *********************************************************************************/
-char * checkAscValues (int a [ ], int n) {
-    for (int i = 0; i < n; i++) {
-        if (a[i] != 2*i) {
-            //printf ("%4d %4d", i, a[i]);
-            return "NO";
+void siftDownDAry (int array [ ], int hole, int size) {
+    int item = array[hole];
+    int top = hole;
+    int child;
+
+    // move the hole down to a leaf, pulling the largest child up each level
+    while ((child = heapArity * hole + 1) < size) {
+        int grandchild = heapArity * child + 1;
+        for (int g = grandchild; g < size && g < grandchild + heapArity * heapArity; g += 16)
+            __builtin_prefetch (&array[g]);
+
+        int last = (child + heapArity < size) ? child + heapArity : size;
+        int large = child;
+        for (int c = child + 1; c < last; c++) {
+            if (opCompare (array[c] > array[large]))
+                large = c;
         }
+        array[hole] = array[large];
+        opWrite ();
+        hole = large;
     }
-    return "ok";
+
+    // the sifted element rises from the leaf to its place
+    while (hole > top) {
+        int parent = (hole - 1) / heapArity;
+        if (opCompare (array[parent] >= item))
+            break;
+        array[hole] = array[parent];
+        opWrite ();
+        hole = parent;
+    }
+    array[hole] = item;
+    opWrite ();
 }
 
 /** *******************************************************************************
- * check all array elements are in non-descending order                           *
+ * d-ary heap sort, main function: heapSort with heapArity children per node,     *
+ * so the heap is log_heapArity n levels deep, and iterative sifting, so the      *
+ * stack stays bounded                                                            *
  * @param  a  the array to be sorted                                              *
  * @param  n  the size of the array                                               *
- * returns  "ok" if array elements in non-descending order; "NO" otherwise        *
+ * @post  the first n elements of a are sorted in non-descending order            *
  *********************************************************************************/
-char * checkAscending (int a [ ], int n) {
-    for (int i = 0; i < n-1; i++) {
-        if (a[i] > a[i+1])
-            return "NO";
+void dAryHeapSort (int a [ ], int n) {
+    // Build Heap
+    for (int i = (n - 2) / heapArity; i >= 0; i--) {
+        siftDownDAry (a, i, n);
     }
-    return "ok";
-}
-
-/** *******************************************************************************
- * driver program for testing and timing sorting algorithms                       *
- **********************************************************************************/
-int main ( ) {
-    // declare array, indicating sorting algorithm names and function pointers
-    #define numAlgs  6
-    sorts sortProcs [numAlgs] = {{"selection sort", selectionSort},
-                                 {"insertion sort", insertionSort},
-                                 {"quicksort     ", quicksort   },
-                                 {"imp. quicksort", impQuicksort },
-                                 {"merge sort    ", mergeSort    },
-                                 {"heap sort     ", heapSort     }};
-
-    //size variables 40960000
-    //nSquared 160000
-    int maxDataSetSize = 40960000;
-    int nSquaredCutoff = 160000; // do not print results from n^2 algorithms beyond this size data set
 
-    // randomize random number generator's seed
-    srand (time ((time_t *) 0) );
-    //srandom (time ((time_t *) 0) );
+    for (int i = n - 1; i > 0; i--) {
+        int tmp = a[0];
+        a[0] = a[i];
+        a[i] = tmp;                // deleteMax
+        opSwap ();
+        siftDownDAry (a, 0, i);    // Maintain heap ordering property
+    }
+}
 
-    // print headings
-    printf ("               Data Set                                Times\n");
-    printf ("Algorithm        Size        Ascending Order       Random Order   Descending Order\n");
+/* * * * * * * * * * * * introsort and helper functions  * * * * * * * * * * * * */
 
-    int size; //10000
-    for (size = 10000; size <= maxDataSetSize; size *= 2) {
-        // create and initialize control data set arrays
-        int * asc = (int *) malloc (size * sizeof(int));   //array with ascending data
-        int * ran = (int *) malloc (size * sizeof(int));   //array with random data
-        int * des = (int *) malloc (size * sizeof(int));   // array with descending data
+#define introInsertionCutoff 16  // ranges of at most this size use insertion sort
 
-        int i;
-        for (i = 0; i< size; i++) {
-            asc[i] = 2*i;
-            ran[i] = rand();
-            des[i] = 2*(size - i - 1);
+/** *******************************************************************************
+ * introsort helper function                                                      *
+ * quicksort using partition, recursing on the smaller side and looping on the    *
+ * larger, so stack depth is O(log n); once depthLimit partitions have been       *
+ * applied to a range, the range is heap sorted instead                           *
+ * @param  a           the array to be processed                                  *
+ * @param  size        the size of the array                                      *
+ * @param  left        the lower index for items to be processed                  *
+ * @param  right       the upper index for items to be processed                  *
+ * @param  depthLimit  partitions allowed before switching to heap sort           *
+ * @post  sorts elements of a between left and right                              *
+ *********************************************************************************/
+void introsortHelper (int a [ ], int size, int left, int right, int depthLimit) {
+    while (right - left + 1 > introInsertionCutoff) {
+        if (depthLimit == 0) {
+            heapSort (a + left, right - left + 1);
+            return;
         }
+        depthLimit--;
 
-        // timing variables
-        clock_t start_time, end_time;
-        double elapsed_time;
+        int mid = partition (a, size, left, right);
+        if (mid - left < right - mid) {
+            introsortHelper (a, size, left, mid - 1, depthLimit);
+            left = mid + 1;
+        } else {
+            introsortHelper (a, size, mid + 1, right, depthLimit);
+            right = mid - 1;
+        }
+    }
+    if (left < right)
+        insertionSort (a + left, right - left + 1);
+}
 
-        /* loop to test successive sorting procedures */
-        // copy to test arrays
-        int * tempAsc = (int *) malloc (size * sizeof(int));
-        int * tempRan = (int *) malloc (size * sizeof(int));
-        int * tempDes = (int *) malloc (size * sizeof(int));
+/** *******************************************************************************
+ * introsort, main function                                                       *
+ * depth limit is 2 floor(log2 n), as in Musser's original introsort              *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void introsort (int a [ ], int n) {
+    int depthLimit = 0;
+    for (int m = n; m > 1; m /= 2)
+        depthLimit += 2;
+    introsortHelper (a, n, 0, n-1, depthLimit);
+}
 
-        // break output for this array size
-        printf ("\n");
+/* * * * * * * * * * * multi-pivot quicksorts and helpers * * * * * * * * * * */
 
-        /* iterate through sorting algorithms */
-        int numSort;
+#define multiPivotCutoff 16  // ranges of at most this size use insertion sort
 
-        for (numSort = 0; numSort < numAlgs; numSort++) {
+/** *******************************************************************************
+ * swap function to interchange two array elements                                *
+ * @param   a  the array                                                          *
+ * @param   i  the index of one element                                           *
+ * @param   j  the index of the other element                                     *
+ * @post    a[i] and a[j] are exchanged                                           *
+ *********************************************************************************/
+void swapElts (int a [ ], int i, int j) {
+    int temp = a[i];
+    a[i] = a[j];
+    a[j] = temp;
+    opSwap ();
+}
+
+/** *******************************************************************************
+ * dual-pivot partition (Yaroslavskiy), pivots p = a[left] <= q = a[right]        *
+ * @param  a      the array to be processed                                       *
+ * @param  left   the lower index for items to be processed                       *
+ * @param  right  the upper index for items to be processed                       *
+ * @param  lp     set to the final index of p                                     *
+ * @param  rp     set to the final index of q                                     *
+ * @post   items between left and lp-1 are < p,                                   *
+ *         items between lp+1 and rp-1 are >= p and <= q,                         *
+ *         items between rp+1 and right are > q                                   *
+ *********************************************************************************/
+void dualPivotPartition (int a [ ], int left, int right, int * lp, int * rp) {
+    if (opCompare (a[left] > a[right]))
+        swapElts (a, left, right);
+    int p = a[left];
+    int q = a[right];
+    int l = left + 1;    // a[left+1..l-1] < p
+    int g = right - 1;   // a[g+1..right-1] > q
+    int k = l;           // a[l..k-1] between p and q
 
-            for (i = 0; i< size; i++) {
-                tempAsc[i] = asc[i];
-                tempRan[i] = ran[i];
-                tempDes[i] = des[i];
+    while (k <= g) {
+        if (opCompare (a[k] < p)) {
+            swapElts (a, k, l);
+            l++;
+        } else if (opCompare (a[k] > q)) {
+            while (opCompare (a[g] > q) && k < g)
+                g--;
+            swapElts (a, k, g);
+            g--;
+            if (opCompare (a[k] < p)) {
+                swapElts (a, k, l);
+                l++;
             }
+        }
+        k++;
+    }
+    l--;
+    g++;
+
+    // move the pivots between the parts
+    swapElts (a, left, l);
+    swapElts (a, right, g);
+    *lp = l;
+    *rp = g;
+}
+
+/** *******************************************************************************
+ * dual-pivot quicksort helper function                                           *
+ * @param  a      the array to be processed                                       *
+ * @param  left   the lower index for items to be processed                       *
+ * @param  right  the upper index for items to be processed                       *
+ * @post  sorts elements of a between left and right                              *
+ *********************************************************************************/
+void dualPivotQuicksortHelper (int a [ ], int left, int right) {
+    if (right - left + 1 <= multiPivotCutoff) {
+        if (left < right)
+            insertionSort (a + left, right - left + 1);
+        return;
+    }
+
+    // random pivots, as in impPartition
+    swapElts (a, left, left + rand() % (right-left+1));
+    swapElts (a, right, left + 1 + rand() % (right-left));
+
+    int lp, rp;
+    dualPivotPartition (a, left, right, &lp, &rp);
+    dualPivotQuicksortHelper (a, left, lp - 1);
+    // with equal pivots, the middle part holds only copies of the pivot
+    if (opCompare (a[lp] < a[rp]))
+        dualPivotQuicksortHelper (a, lp + 1, rp - 1);
+    dualPivotQuicksortHelper (a, rp + 1, right);
+}
+
+/** *******************************************************************************
+ * dual-pivot quicksort, main function                                            *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void dualPivotQuicksort (int a [ ], int n) {
+    dualPivotQuicksortHelper (a, 0, n-1);
+}
+
+/** *******************************************************************************
+ * three-pivot partition (Kushagra, Lopez-Ortiz, Qiao and Munro, "Multi-Pivot     *
+ * Quicksort: Theory and Experiments", ALENEX 2014)                               *
+ * @param  a      the array to be processed                                       *
+ * @param  left   the lower index for items to be processed                       *
+ * @param  right  the upper index for items to be processed                       *
+ * @param  pos    set to the final indices of the pivots p <= q <= r              *
+ * @pre    p = a[left] <= q = a[left+1] <= r = a[right], with right-left >= 2     *
+ * @post   items between left and pos[0]-1 are < p,                               *
+ *         items between pos[0]+1 and pos[1]-1 are >= p and <= q,                 *
+ *         items between pos[1]+1 and pos[2]-1 are >= q and <= r,                 *
+ *         items between pos[2]+1 and right are > r                               *
+ *********************************************************************************/
+void threePivotPartition (int a [ ], int left, int right, int pos [3]) {
+    int p = a[left];
+    int q = a[left + 1];
+    int r = a[right];
+    int i = left + 2;   // a[left+2..i-1] < p
+    int j = left + 2;   // a[i..j-1] between p and q
+    int k = right - 1;  // a[k+1..l] between q and r
+    int l = right - 1;  // a[l+1..right-1] > r
 
-            // timing for sorting algorithm
-            printf ("%14s %8d", sortProcs[numSort].name, size);
-            // run-time stack exceeded for quicksort for large ordered arrays
-            if ((numSort <= 3) && (size > nSquaredCutoff)) {
-                printf ("           ---  --");
+    while (j <= k) {
+        while (opCompare (a[j] < q) && j <= k) {
+            if (opCompare (a[j] < p)) {
+                swapElts (a, i, j);
+                i++;
+            }
+            j++;
+        }
+        while (opCompare (a[k] > q) && j <= k) {
+            if (opCompare (a[k] > r)) {
+                swapElts (a, k, l);
+                l--;
+            }
+            k--;
+        }
+        if (j <= k) {
+            // a[j] >= q and a[k] <= q are both misplaced
+            if (opCompare (a[j] > r)) {
+                if (opCompare (a[k] < p)) {
+                    swapElts (a, j, i);
+                    swapElts (a, i, k);
+                    i++;
+                } else {
+                    swapElts (a, j, k);
+                }
+                swapElts (a, k, l);
+                j++;
+                k--;
+                l--;
             } else {
-                // ascending data
-                start_time = clock ();
-                sortProcs[numSort].sortProc (tempAsc, size);
-                end_time = clock();
-                elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-                printf ("%14.1lf", elapsed_time);
-                printf ("  %2s", checkAscValues (tempAsc, size));
+                if (opCompare (a[k] < p)) {
+                    swapElts (a, j, i);
+                    swapElts (a, i, k);
+                    i++;
+                } else {
+                    swapElts (a, j, k);
+                }
+                j++;
+                k--;
             }
+        }
+    }
+    i--;
+    j--;
+    l++;
 
-            if ((numSort <= 2) && (size > nSquaredCutoff)) {
-                printf ("            ---  --");
-            } else {
-                // random data
-                start_time = clock ();
-                sortProcs[numSort].sortProc (tempRan, size);
-                end_time = clock();
-                elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-                printf ("%15.1lf", elapsed_time);
-                printf ("  %2s", checkAscending (tempAsc, size));
+    // move the pivots between the parts
+    swapElts (a, left + 1, i);
+    swapElts (a, i, j);
+    i--;
+    swapElts (a, left, i);
+    swapElts (a, right, l);
+    pos[0] = i;
+    pos[1] = j;
+    pos[2] = l;
+}
+
+/** *******************************************************************************
+ * three-pivot quicksort helper function                                          *
+ * @param  a      the array to be processed                                       *
+ * @param  left   the lower index for items to be processed                       *
+ * @param  right  the upper index for items to be processed                       *
+ * @post  sorts elements of a between left and right                              *
+ *********************************************************************************/
+void threePivotQuicksortHelper (int a [ ], int left, int right) {
+    if (right - left + 1 <= multiPivotCutoff) {
+        if (left < right)
+            insertionSort (a + left, right - left + 1);
+        return;
+    }
+
+    // three random pivots, in order at a[left], a[left+1], a[right]
+    swapElts (a, left, left + rand() % (right-left+1));
+    swapElts (a, left + 1, left + 1 + rand() % (right-left));
+    swapElts (a, right, left + 2 + rand() % (right-left-1));
+    if (opCompare (a[left] > a[left + 1]))
+        swapElts (a, left, left + 1);
+    if (opCompare (a[left + 1] > a[right]))
+        swapElts (a, left + 1, right);
+    if (opCompare (a[left] > a[left + 1]))
+        swapElts (a, left, left + 1);
+
+    int pos [3];
+    threePivotPartition (a, left, right, pos);
+    threePivotQuicksortHelper (a, left, pos[0] - 1);
+    threePivotQuicksortHelper (a, pos[0] + 1, pos[1] - 1);
+    threePivotQuicksortHelper (a, pos[1] + 1, pos[2] - 1);
+    threePivotQuicksortHelper (a, pos[2] + 1, right);
+}
+
+/** *******************************************************************************
+ * three-pivot quicksort, main function                                           *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void threePivotQuicksort (int a [ ], int n) {
+    threePivotQuicksortHelper (a, 0, n-1);
+}
+
+/* * * * * * * * * * * * LSD radix sort  * * * * * * * * * * * * * * * */
+
+/** *******************************************************************************
+ * least-significant-digit radix sort on the four bytes of each int               *
+ * one pre-pass counts all four digit histograms; a pass is skipped when every    *
+ * key has the same digit there.  Keys are compared with their sign bit flipped,  *
+ * so negative values order before non-negative ones                              *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void radixSort (int a [ ], int n) {
+    if (n < 2)
+        return;
+
+    int * buf = (int *) malloc (n * sizeof(int));
+    int counts [4][256] = {{0}};
+    const unsigned int signBit = 0x80000000u;
+
+    // histogram pre-pass, all digits in one read of the array
+    for (int i = 0; i < n; i++) {
+        unsigned int key = (unsigned int) a[i] ^ signBit;
+        counts[0][key & 0xff]++;
+        counts[1][(key >> 8) & 0xff]++;
+        counts[2][(key >> 16) & 0xff]++;
+        counts[3][key >> 24]++;
+    }
+
+    int * src = a;
+    int * dst = buf;
+    for (int pass = 0; pass < 4; pass++) {
+        int shift = 8 * pass;
+        int * count = counts[pass];
+
+        // all keys share this digit, so the pass would not move anything
+        if (count[(((unsigned int) src[0] ^ signBit) >> shift) & 0xff] == n)
+            continue;
+
+        // turn digit counts into starting offsets
+        int offset = 0;
+        for (int d = 0; d < 256; d++) {
+            int c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+
+        for (int i = 0; i < n; i++) {
+            unsigned int key = (unsigned int) src[i] ^ signBit;
+            dst[count[(key >> shift) & 0xff]++] = src[i];
+        }
+        opWrites (n);
+
+        int * temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    //copy result into a, as needed
+    if (src != a) {
+        for (int i = 0; i < n; i++)
+            a[i] = src[i];
+        opWrites (n);
+    }
+
+    free (buf);
+}
+
+/* * * * * * * * * in-place MSD radix sort (American flag sort)  * * * * * * * * */
+
+#define flagSortCutoff 32  // buckets of at most this size are finished by insertion sort
+
+/** *******************************************************************************
+ * American flag sort helper function                                             *
+ * distributes a[0..n-1] into 256 buckets on the digit at shift, in place, by     *
+ * cycling each misplaced item to the next free slot of its bucket, then sorts    *
+ * each bucket on the next lower digit                                            *
+ * @param  a      the array segment to be sorted                                  *
+ * @param  n      the size of the segment                                         *
+ * @param  shift  bit position of the digit used at this level (24, 16, 8, 0)     *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void americanFlagSortHelper (int a [ ], int n, int shift) {
+    const unsigned int signBit = 0x80000000u;
+    int count [256] = {0};
+    int next [256];   // next unfilled slot in each bucket
+    int end [256];    // one past the last slot of each bucket
+
+    for (int i = 0; i < n; i++)
+        count[(((unsigned int) a[i] ^ signBit) >> shift) & 0xff]++;
+
+    int offset = 0;
+    for (int d = 0; d < 256; d++) {
+        next[d] = offset;
+        offset += count[d];
+        end[d] = offset;
+    }
+
+    // place items bucket by bucket; each swap puts one item in its final bucket
+    for (int d = 0; d < 256; d++) {
+        while (next[d] < end[d]) {
+            int item = a[next[d]];
+            int digit = (((unsigned int) item ^ signBit) >> shift) & 0xff;
+            while (digit != d) {
+                int temp = a[next[digit]];
+                a[next[digit]++] = item;
+                opWrite ();
+                item = temp;
+                digit = (((unsigned int) item ^ signBit) >> shift) & 0xff;
             }
+            a[next[d]++] = item;
+            opWrite ();
+        }
+    }
 
-            // run-time stack exceeded for quicksort for large ordered arrays
-            if ((numSort <= 3) && (size > nSquaredCutoff)) {
-                printf ("            ---  --");
-            } else {
-                // descending data
-                start_time = clock ();
-                sortProcs[numSort].sortProc (tempDes, size);
-                end_time = clock();
-                elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-                printf ("%15.1lf", elapsed_time);
-                printf ("  %2s", checkAscValues (tempDes, size));
+    if (shift == 0)
+        return;
+
+    // sort each bucket on the next digit
+    int start = 0;
+    for (int d = 0; d < 256; d++) {
+        if (count[d] > flagSortCutoff)
+            americanFlagSortHelper (a + start, count[d], shift - 8);
+        else if (count[d] > 1)
+            insertionSort (a + start, count[d]);
+        start += count[d];
+    }
+}
+
+/** *******************************************************************************
+ * American flag sort, main function                                              *
+ * in-place MSD radix sort; extra memory is 3 x 256 counters per level,           *
+ * at most four levels deep                                                       *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+ *********************************************************************************/
+void americanFlagSort (int a [ ], int n) {
+    if (n > flagSortCutoff)
+        americanFlagSortHelper (a, n, 24);
+    else
+        insertionSort (a, n);
+}
+
+/* * * * * * * * * * * * typed sort library  * * * * * * * * * * * * * * * */
+
+/** *******************************************************************************
+ * the sorts above all work on int arrays.  defineTypedSorts(T, type, less)       *
+ * generates insertionSort_T, heapSort_T, mergeSort_T and introsort_T for any     *
+ * element type, where less(x, y) is a macro or function giving x < y.  Since     *
+ * less is expanded in place, the inner loops make no indirect call per           *
+ * comparison.  Each sort also gets an untyped wrapper, sortName_T_v, taking      *
+ * void *, so one table can hold the same algorithm for several types; a key      *
+ * extractor fits the same scheme, as less (x, y) = key(x) < key(y)               *
+ *********************************************************************************/
+#define defineTypedSorts(T, type, less)                                               \
+                                                                                      \
+/* insertion sort, as insertionSort */                                                \
+void insertionSort_##T (type a [ ], int n) {                                          \
+    for (int k = 1; k < n; k++) {                                                     \
+        type item = a[k];                                                             \
+        int i = k-1;                                                                  \
+        while ((i >= 0) && less (item, a[i])) {                                       \
+            a[i+1] = a[i];                                                            \
+            i--;                                                                      \
+        }                                                                             \
+        a[i+1] = item;                                                                \
+    }                                                                                 \
+}                                                                                     \
+                                                                                      \
+/* heap sort, as heapSort, with percDown moving the hole instead of swapping */       \
+void percDown_##T (type array [ ], int hole, int size) {                              \
+    type item = array[hole];                                                          \
+    int child = 2 * hole + 1;                                                         \
+    while (child < size) {                                                            \
+        if (child + 1 < size && less (array[child], array[child+1]))                  \
+            child++;                                                                  \
+        if (!less (item, array[child]))                                               \
+            break;                                                                    \
+        array[hole] = array[child];                                                   \
+        hole = child;                                                                 \
+        child = 2 * hole + 1;                                                         \
+    }                                                                                 \
+    array[hole] = item;                                                               \
+}                                                                                     \
+                                                                                      \
+void heapSort_##T (type a [ ], int n) {                                               \
+    for (int i = n/2 - 1; i >= 0; i--)                                                \
+        percDown_##T (a, i, n);                                                       \
+    for (int i = n-1; i > 0; i--) {                                                   \
+        type tmp = a[0];                                                              \
+        a[0] = a[i];                                                                  \
+        a[i] = tmp;                                                                   \
+        percDown_##T (a, 0, i);                                                       \
+    }                                                                                 \
+}                                                                                     \
+                                                                                      \
+/* bottom-up merge sort, as mergeSort */                                              \
+void merge_##T (type aInit [ ], type aRes [ ], int n, int start1, int start2, int end2) { \
+    if (start2 > n)                                                                   \
+        start2 = n;                                                                   \
+    if (end2 > n)                                                                     \
+        end2 = n;                                                                     \
+    int i = start1, j = start2, out = start1;                                         \
+    while (i < start2 && j < end2)                                                    \
+        aRes[out++] = less (aInit[j], aInit[i]) ? aInit[j++] : aInit[i++];            \
+    while (i < start2)                                                                \
+        aRes[out++] = aInit[i++];                                                     \
+    while (j < end2)                                                                  \
+        aRes[out++] = aInit[j++];                                                     \
+}                                                                                     \
+                                                                                      \
+void mergeSort_##T (type initArr [ ], int n) {                                        \
+    type * a0 = initArr;                                                              \
+    type * a1 = (type *) malloc (n * sizeof(type));                                   \
+    type * resArr = a1;                                                               \
+    for (int mergeSize = 1; mergeSize < n; mergeSize *= 2) {                          \
+        for (int start1 = 0; start1 < n; start1 += 2 * mergeSize)                     \
+            merge_##T (a0, a1, n, start1, start1 + mergeSize, start1 + 2 * mergeSize); \
+        type * temp = a0;                                                             \
+        a0 = a1;                                                                      \
+        a1 = temp;                                                                    \
+    }                                                                                 \
+    if (a0 != initArr)                                                                \
+        memcpy (initArr, a0, n * sizeof(type));                                       \
+    free (resArr);                                                                    \
+}                                                                                     \
+                                                                                      \
+/* introsort, as introsort, with the random-pivot partition of impPartition */        \
+int partition_##T (type a [ ], int left, int right) {                                 \
+    int pivotIndex = left + (rand() % (right-left+1));                                \
+    type pivot = a[pivotIndex];                                                       \
+    int l_spot = left+1;                                                              \
+    int r_spot = right;                                                               \
+    type temp = a[left];                                                              \
+    a[left] = a[pivotIndex];                                                          \
+    a[pivotIndex] = temp;                                                             \
+                                                                                      \
+    while (l_spot <= r_spot) {                                                        \
+        while ((l_spot <= r_spot) && !less (a[r_spot], pivot))                        \
+            r_spot--;                                                                 \
+        while ((l_spot <= r_spot) && !less (pivot, a[l_spot]))                        \
+            l_spot++;                                                                 \
+        if (l_spot < r_spot) {                                                        \
+            temp = a[l_spot];                                                         \
+            a[l_spot] = a[r_spot];                                                    \
+            a[r_spot] = temp;                                                         \
+            l_spot++;                                                                 \
+            r_spot--;                                                                 \
+        }                                                                             \
+    }                                                                                 \
+    temp = a[left];                                                                   \
+    a[left] = a[r_spot];                                                              \
+    a[r_spot] = temp;                                                                 \
+    return r_spot;                                                                    \
+}                                                                                     \
+                                                                                      \
+void introsortHelper_##T (type a [ ], int left, int right, int depthLimit) {          \
+    while (right - left + 1 > introInsertionCutoff) {                                 \
+        if (depthLimit == 0) {                                                        \
+            heapSort_##T (a + left, right - left + 1);                                \
+            return;                                                                   \
+        }                                                                             \
+        depthLimit--;                                                                 \
+        int mid = partition_##T (a, left, right);                                     \
+        if (mid - left < right - mid) {                                               \
+            introsortHelper_##T (a, left, mid - 1, depthLimit);                       \
+            left = mid + 1;                                                           \
+        } else {                                                                      \
+            introsortHelper_##T (a, mid + 1, right, depthLimit);                      \
+            right = mid - 1;                                                          \
+        }                                                                             \
+    }                                                                                 \
+    if (left < right)                                                                 \
+        insertionSort_##T (a + left, right - left + 1);                               \
+}                                                                                     \
+                                                                                      \
+void introsort_##T (type a [ ], int n) {                                              \
+    int depthLimit = 0;                                                               \
+    for (int m = n; m > 1; m /= 2)                                                    \
+        depthLimit += 2;                                                              \
+    introsortHelper_##T (a, 0, n-1, depthLimit);                                      \
+}                                                                                     \
+                                                                                      \
+/* check, as checkAscending */                                                        \
+char * checkAscending_##T (type a [ ], int n) {                                       \
+    for (int i = 0; i < n-1; i++) {                                                   \
+        if (less (a[i+1], a[i]))                                                      \
+            return "NO";                                                              \
+    }                                                                                 \
+    return "ok";                                                                      \
+}                                                                                     \
+                                                                                      \
+/* untyped entry points, for the typedSorts table */                                  \
+void insertionSort_##T##_v (void * a, int n) { insertionSort_##T ((type *) a, n); }   \
+void heapSort_##T##_v (void * a, int n) { heapSort_##T ((type *) a, n); }             \
+void mergeSort_##T##_v (void * a, int n) { mergeSort_##T ((type *) a, n); }           \
+void introsort_##T##_v (void * a, int n) { introsort_##T ((type *) a, n); }           \
+char * checkAscending_##T##_v (void * a, int n) { return checkAscending_##T ((type *) a, n); }
+
+/* comparison macros for the generated sorts; floating-point NaNs sort last */
+#define numericLess(x, y)  ((x) < (y))
+#define floatLess(x, y)    ((x) < (y) || ((y) != (y) && (x) == (x)))
+#define stringLess(x, y)   (strcmp ((x), (y)) < 0)
+
+defineTypedSorts (i32, int, numericLess)
+defineTypedSorts (i64, long long, numericLess)
+defineTypedSorts (u64, unsigned long long, numericLess)
+defineTypedSorts (f64, double, floatLess)
+defineTypedSorts (f32, float, floatLess)
+defineTypedSorts (str, char *, stringLess)
+
+/** *******************************************************************************
+ * merge sort for elements known only by size and a comparison function,          *
+ * in the style of the C library qsort; the general fallback when no typed        *
+ * version was generated.  Every comparison is an indirect call and every move    *
+ * a memcpy, which the typed versions avoid                                       *
+ * @param  base      the array to be sorted                                       *
+ * @param  n         the number of elements                                       *
+ * @param  elemSize  bytes per element                                            *
+ * @param  compare   returns <0, 0, >0 as its first argument is less than, equal  *
+ *                   to, or greater than its second                               *
+ * @post  the first n elements of base are sorted in non-descending order         *
+ *********************************************************************************/
+void genericMergeSort (void * base, int n, size_t elemSize,
+                       int (*compare) (const void *, const void *)) {
+    char * a0 = (char *) base;
+    char * a1 = (char *) malloc (n * elemSize);
+    char * resArr = a1;
+
+    for (int mergeSize = 1; mergeSize < n; mergeSize *= 2) {
+        for (int start1 = 0; start1 < n; start1 += 2 * mergeSize) {
+            int start2 = (start1 + mergeSize < n) ? start1 + mergeSize : n;
+            int end2 = (start2 + mergeSize < n) ? start2 + mergeSize : n;
+            int i = start1, j = start2, out = start1;
+            while (i < start2 && j < end2) {
+                if (compare (a0 + j * elemSize, a0 + i * elemSize) < 0)
+                    memcpy (a1 + (out++) * elemSize, a0 + (j++) * elemSize, elemSize);
+                else
+                    memcpy (a1 + (out++) * elemSize, a0 + (i++) * elemSize, elemSize);
+            }
+            memcpy (a1 + out * elemSize, a0 + i * elemSize, (start2 - i) * elemSize);
+            out += start2 - i;
+            memcpy (a1 + out * elemSize, a0 + j * elemSize, (end2 - j) * elemSize);
+        }
+        char * temp = a0;
+        a0 = a1;
+        a1 = temp;
+    }
+    if (a0 != (char *) base)
+        memcpy (base, a0, n * elemSize);
+    free (resArr);
+}
+
+/** *******************************************************************************
+ * comparison function for genericMergeSort on ints                               *
+ *********************************************************************************/
+int compareInts (const void * x, const void * y) {
+    int a = * (const int *) x;
+    int b = * (const int *) y;
+    return (a > b) - (a < b);
+}
+
+/** *******************************************************************************
+ * genericMergeSort on ints, for timing against the typed mergeSort_i32           *
+ *********************************************************************************/
+void genericMergeSort_i32_v (void * a, int n) {
+    genericMergeSort (a, n, sizeof(int), compareInts);
+}
+
+/* * * * * * * * * argsort: sorting records through their keys * * * * * * * * */
+
+/* records of 64, 128 and 256 bytes, each with its sort key first */
+typedef struct record64 {
+    long long key;
+    char payload [56];
+} record64;
+
+typedef struct record128 {
+    long long key;
+    char payload [120];
+} record128;
+
+typedef struct record256 {
+    long long key;
+    char payload [248];
+} record256;
+
+/* a key cached beside the index of its record, so sorting reads no records */
+typedef struct keyIndex {
+    long long key;
+    int index;
+} keyIndex;
+
+/* records being argsorted by index alone, for indexLess */
+char * argsortBase;
+size_t argsortStride;
+
+#define recordLess(x, y)    ((x).key < (y).key)
+#define keyIndexLess(x, y)  ((x).key < (y).key)
+#define argsortKey(i)       (* (long long *) (argsortBase + (size_t) (i) * argsortStride))
+#define indexLess(i, j)     (argsortKey (i) < argsortKey (j))
+
+defineTypedSorts (rec64, record64, recordLess)
+defineTypedSorts (rec128, record128, recordLess)
+defineTypedSorts (rec256, record256, recordLess)
+defineTypedSorts (ki, keyIndex, keyIndexLess)
+defineTypedSorts (idx, int, indexLess)
+
+/** *******************************************************************************
+ * argsort by index: sorts the indices of the records by key, leaving the         *
+ * records in place                                                               *
+ * @param  records      the records, each starting with a long long key           *
+ * @param  n            the number of records                                     *
+ * @param  recordSize   bytes per record                                          *
+ * @param  sortIndices  an idx sort, such as introsort_idx                        *
+ * @param  perm         receives the permutation                                  *
+ * @post  records[perm[0]], records[perm[1]], ... are in non-descending order     *
+ *********************************************************************************/
+void argsortIndex (void * records, int n, size_t recordSize,
+                   void (*sortIndices) (int [ ], int), int perm [ ]) {
+    for (int i = 0; i < n; i++)
+        perm[i] = i;
+    argsortBase = (char *) records;
+    argsortStride = recordSize;
+    sortIndices (perm, n);
+}
+
+/** *******************************************************************************
+ * argsort with cached keys: sorts (key, index) pairs, so comparisons touch       *
+ * only the pairs array and not the wide records                                  *
+ * @param  records     the records, each starting with a long long key            *
+ * @param  n           the number of records                                      *
+ * @param  recordSize  bytes per record                                           *
+ * @param  sortPairs   a ki sort, such as introsort_ki                            *
+ * @param  perm        receives the permutation                                   *
+ * @post  records[perm[0]], records[perm[1]], ... are in non-descending order     *
+ *********************************************************************************/
+void argsortCached (void * records, int n, size_t recordSize,
+                    void (*sortPairs) (keyIndex [ ], int), int perm [ ]) {
+    keyIndex * pairs = (keyIndex *) malloc (n * sizeof(keyIndex));
+    for (int i = 0; i < n; i++) {
+        pairs[i].key = * (long long *) ((char *) records + i * recordSize);
+        pairs[i].index = i;
+    }
+    sortPairs (pairs, n);
+    for (int i = 0; i < n; i++)
+        perm[i] = pairs[i].index;
+    free (pairs);
+}
+
+/** *******************************************************************************
+ * apply a permutation to records in place, following each cycle of the           *
+ * permutation so every record is moved exactly once                              *
+ * @param  records     the records                                                *
+ * @param  n           the number of records                                      *
+ * @param  recordSize  bytes per record                                           *
+ * @param  perm        the permutation, as produced by argsort                    *
+ * @post  the record formerly at perm[i] is now at i; perm is unchanged           *
+ *********************************************************************************/
+void applyPermutation (void * records, int n, size_t recordSize, int perm [ ]) {
+    char * rec = (char *) records;
+    char * temp = (char *) malloc (recordSize);
+
+    for (int start = 0; start < n; start++) {
+        // entries already moved are marked by complementing them
+        if (perm[start] < 0 || perm[start] == start)
+            continue;
+        memcpy (temp, rec + start * recordSize, recordSize);
+        int hole = start;
+        while (perm[hole] != start) {
+            int next = perm[hole];
+            memcpy (rec + hole * recordSize, rec + next * recordSize, recordSize);
+            perm[hole] = ~next;
+            hole = next;
+        }
+        memcpy (rec + hole * recordSize, temp, recordSize);
+        perm[hole] = ~start;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (perm[i] < 0)
+            perm[i] = ~perm[i];
+    }
+    free (temp);
+}
+
+/* * * * * * * * * * * * stable sorting: powersort  * * * * * * * * * * * * * */
+
+#define minRun    32  // runs shorter than this are extended by binary insertion
+#define minGallop  7  // wins in a row from one run before a merge gallops
+
+/** *******************************************************************************
+ * node power of the boundary between adjacent runs a[startA..startB-1] and       *
+ * a[startB..endB-1] in an array of n elements: the first bit where the binary    *
+ * fractions of the run midpoints, as parts of n, differ.  Powersort merges       *
+ * boundaries of higher power first, which keeps merges nearly balanced           *
+ * @returns  the power, at least 1                                                *
+ *********************************************************************************/
+int nodePower (int n, int startA, int startB, int endB) {
+    long long twoN = 2LL * n;
+    long long a = (long long) startA + startB;   // twice the midpoint of the first run
+    long long b = (long long) startB + endB;     // twice the midpoint of the second run
+    int power = 0;
+
+    while (1) {
+        power++;
+        a *= 2;
+        b *= 2;
+        int bitA = a >= twoN;
+        int bitB = b >= twoN;
+        if (bitA != bitB)
+            return power;
+        if (bitA) {
+            a -= twoN;
+            b -= twoN;
+        }
+    }
+}
+
+/** *******************************************************************************
+ * defineStableSort(T, type, less) generates stableSort_T, a stable powersort     *
+ * for the element type, alongside the defineTypedSorts versions.  Runs already   *
+ * in order, or strictly descending, are found and reversed as needed, so         *
+ * presorted input takes linear time                                              *
+ *********************************************************************************/
+#define defineStableSort(T, type, less)                                               \
+                                                                                      \
+/* first index in a[0..n-1] holding an element not less than key */                   \
+int gallopLeft_##T (type key, type a [ ], int n) {                                    \
+    if (n == 0 || !less (a[0], key))                                                  \
+        return 0;                                                                     \
+    int last = 0, ofs = 1;                                                            \
+    while (ofs < n && less (a[ofs], key)) {                                           \
+        last = ofs;                                                                   \
+        ofs = 2 * ofs + 1;                                                            \
+    }                                                                                 \
+    int lo = last + 1, hi = (ofs < n) ? ofs : n;                                      \
+    while (lo < hi) {                                                                 \
+        int mid = lo + (hi - lo) / 2;                                                 \
+        if (less (a[mid], key))                                                       \
+            lo = mid + 1;                                                             \
+        else                                                                          \
+            hi = mid;                                                                 \
+    }                                                                                 \
+    return lo;                                                                        \
+}                                                                                     \
+                                                                                      \
+/* first index in a[0..n-1] holding an element greater than key */                    \
+int gallopRight_##T (type key, type a [ ], int n) {                                   \
+    if (n == 0 || less (key, a[0]))                                                   \
+        return 0;                                                                     \
+    int last = 0, ofs = 1;                                                            \
+    while (ofs < n && !less (key, a[ofs])) {                                          \
+        last = ofs;                                                                   \
+        ofs = 2 * ofs + 1;                                                            \
+    }                                                                                 \
+    int lo = last + 1, hi = (ofs < n) ? ofs : n;                                      \
+    while (lo < hi) {                                                                 \
+        int mid = lo + (hi - lo) / 2;                                                 \
+        if (less (key, a[mid]))                                                       \
+            hi = mid;                                                                 \
+        else                                                                          \
+            lo = mid + 1;                                                             \
+    }                                                                                 \
+    return lo;                                                                        \
+}                                                                                     \
+                                                                                      \
+/* merge a[s1..s2-1] with a[s2..e-1], copying the shorter left run to buf */          \
+void mergeLo_##T (type a [ ], int s1, int s2, int e, type buf [ ]) {                  \
+    int lenA = s2 - s1;                                                               \
+    memcpy (buf, a + s1, lenA * sizeof(type));                                        \
+    int i = 0, j = s2, dest = s1;                                                     \
+    int winsA = 0, winsB = 0;                                                         \
+                                                                                      \
+    while (i < lenA && j < e) {                                                       \
+        if (less (a[j], buf[i])) {                                                    \
+            a[dest++] = a[j++];                                                       \
+            winsB++;                                                                  \
+            winsA = 0;                                                                \
+        } else {                                                                      \
+            a[dest++] = buf[i++];                                                     \
+            winsA++;                                                                  \
+            winsB = 0;                                                                \
+        }                                                                             \
+        if (i == lenA || j == e)                                                      \
+            break;                                                                    \
+        /* after a streak from one side, gallop to copy its next block at once */     \
+        if (winsA >= minGallop) {                                                     \
+            int k = gallopRight_##T (a[j], buf + i, lenA - i);                        \
+            memcpy (a + dest, buf + i, k * sizeof(type));                             \
+            dest += k;                                                                \
+            i += k;                                                                   \
+            winsA = 0;                                                                \
+        } else if (winsB >= minGallop) {                                              \
+            int k = gallopLeft_##T (buf[i], a + j, e - j);                            \
+            memmove (a + dest, a + j, k * sizeof(type));                              \
+            dest += k;                                                                \
+            j += k;                                                                   \
+            winsB = 0;                                                                \
+        }                                                                             \
+    }                                                                                 \
+    memcpy (a + dest, buf + i, (lenA - i) * sizeof(type));                            \
+}                                                                                     \
+                                                                                      \
+/* merge a[s1..s2-1] with a[s2..e-1] from the right, copying the shorter right run to buf */ \
+void mergeHi_##T (type a [ ], int s1, int s2, int e, type buf [ ]) {                  \
+    int lenB = e - s2;                                                                \
+    memcpy (buf, a + s2, lenB * sizeof(type));                                        \
+    int i = s2 - 1, j = lenB - 1, dest = e - 1;                                       \
+    int winsA = 0, winsB = 0;                                                         \
+                                                                                      \
+    while (i >= s1 && j >= 0) {                                                       \
+        if (less (buf[j], a[i])) {                                                    \
+            a[dest--] = a[i--];                                                       \
+            winsA++;                                                                  \
+            winsB = 0;                                                                \
+        } else {                                                                      \
+            a[dest--] = buf[j--];                                                     \
+            winsB++;                                                                  \
+            winsA = 0;                                                                \
+        }                                                                             \
+        if (i < s1 || j < 0)                                                          \
+            break;                                                                    \
+        if (winsA >= minGallop) {                                                     \
+            int k = (i + 1 - s1) - gallopRight_##T (buf[j], a + s1, i + 1 - s1);      \
+            memmove (a + dest - k + 1, a + i - k + 1, k * sizeof(type));              \
+            dest -= k;                                                                \
+            i -= k;                                                                   \
+            winsA = 0;                                                                \
+        } else if (winsB >= minGallop) {                                              \
+            int k = (j + 1) - gallopLeft_##T (a[i], buf, j + 1);                      \
+            memcpy (a + dest - k + 1, buf + j - k + 1, k * sizeof(type));             \
+            dest -= k;                                                                \
+            j -= k;                                                                   \
+            winsB = 0;                                                                \
+        }                                                                             \
+    }                                                                                 \
+    memcpy (a + s1, buf, (j + 1) * sizeof(type));                                     \
+}                                                                                     \
+                                                                                      \
+/* merge adjacent sorted runs a[s1..s2-1] and a[s2..e-1], skipping the                \
+   elements of each run already in their final places */                              \
+void mergeRuns_##T (type a [ ], int s1, int s2, int e, type buf [ ]) {                \
+    s1 += gallopRight_##T (a[s2], a + s1, s2 - s1);                                   \
+    if (s1 == s2)                                                                     \
+        return;                                                                       \
+    e = s2 + gallopLeft_##T (a[s2-1], a + s2, e - s2);                                \
+    if (e == s2)                                                                      \
+        return;                                                                       \
+    /* each merge copies the shorter run out and writes every element back */         \
+    opWrites ((e - s1) + ((s2 - s1 <= e - s2) ? s2 - s1 : e - s2));                   \
+    if (s2 - s1 <= e - s2)                                                            \
+        mergeLo_##T (a, s1, s2, e, buf);                                              \
+    else                                                                              \
+        mergeHi_##T (a, s1, s2, e, buf);                                              \
+}                                                                                     \
+                                                                                      \
+/* find the run starting at lo, reversing it if strictly descending, and              \
+   extend it to minRun elements by binary insertion; returns its end */               \
+int extendRun_##T (type a [ ], int lo, int n) {                                       \
+    int runHi = lo + 1;                                                               \
+    if (runHi < n) {                                                                  \
+        if (less (a[runHi], a[lo])) {                                                 \
+            while (runHi < n && less (a[runHi], a[runHi-1]))                          \
+                runHi++;                                                              \
+            for (int i = lo, j = runHi - 1; i < j; i++, j--) {                        \
+                type temp = a[i];                                                     \
+                a[i] = a[j];                                                          \
+                a[j] = temp;                                                          \
+                opSwap ();                                                            \
+            }                                                                         \
+        } else {                                                                      \
+            while (runHi < n && !less (a[runHi], a[runHi-1]))                         \
+                runHi++;                                                              \
+        }                                                                             \
+    }                                                                                 \
+                                                                                      \
+    int force = (n - lo < minRun) ? n - lo : minRun;                                  \
+    for (; runHi < lo + force; runHi++) {                                             \
+        type item = a[runHi];                                                         \
+        int pos = lo + gallopRight_##T (item, a + lo, runHi - lo);                    \
+        memmove (a + pos + 1, a + pos, (runHi - pos) * sizeof(type));                 \
+        a[pos] = item;                                                                \
+        opWrites (runHi - pos + 1);                                                   \
+    }                                                                                 \
+    return runHi;                                                                     \
+}                                                                                     \
+                                                                                      \
+/* powersort (Munro and Wild): merges natural runs in the order given by              \
+   the node powers of their boundaries, with galloping merges as in Timsort */        \
+void powersort_##T (type a [ ], int n) {                                              \
+    if (n < 2)                                                                        \
+        return;                                                                       \
+    type * buf = (type *) malloc ((n / 2 + 1) * sizeof(type));                        \
+    int stackStart [64];                                                              \
+    int stackPower [64];                                                              \
+    int top = 0;                                                                      \
+                                                                                      \
+    int startA = 0;                                                                   \
+    int endA = extendRun_##T (a, 0, n);                                               \
+    while (endA < n) {                                                                \
+        int endB = extendRun_##T (a, endA, n);                                        \
+        int power = nodePower (n, startA, endA, endB);                                \
+        while (top > 0 && stackPower[top-1] > power) {                                \
+            top--;                                                                    \
+            mergeRuns_##T (a, stackStart[top], startA, endA, buf);                    \
+            startA = stackStart[top];                                                 \
+        }                                                                             \
+        stackStart[top] = startA;                                                     \
+        stackPower[top] = power;                                                      \
+        top++;                                                                        \
+        startA = endA;                                                                \
+        endA = endB;                                                                  \
+    }                                                                                 \
+    while (top > 0) {                                                                 \
+        top--;                                                                        \
+        mergeRuns_##T (a, stackStart[top], startA, endA, buf);                        \
+        startA = stackStart[top];                                                     \
+    }                                                                                 \
+    free (buf);                                                                       \
+}                                                                                     \
+                                                                                      \
+/* the stable sort API: equal elements keep their original order */                   \
+void stableSort_##T (type a [ ], int n) {                                             \
+    powersort_##T (a, n);                                                             \
+}
+
+// the int instance counts its comparisons, when operations are counted
+#define countedLess(x, y)  opCompare ((x) < (y))
+
+defineStableSort (i32, int, countedLess)
+
+/* items with a duplicate-heavy key and their original position, for stability checks */
+typedef struct keyedItem {
+    int key;
+    int seq;
+} keyedItem;
+
+#define keyedLess(x, y)  ((x).key < (y).key)
+
+defineTypedSorts (kv, keyedItem, keyedLess)
+defineStableSort (kv, keyedItem, keyedLess)
+
+/** *******************************************************************************
+ * check keyed items are in key order and items with equal keys kept their        *
+ * original order, as recorded in seq                                             *
+ * @param  a  the sorted items                                                    *
+ * @param  n  the number of items                                                 *
+ * returns  "ok" if the items are sorted stably; "NO" otherwise                   *
+ *********************************************************************************/
+char * checkStable (keyedItem a [ ], int n) {
+    for (int i = 0; i < n-1; i++) {
+        if (a[i].key > a[i+1].key)
+            return "NO";
+        if (a[i].key == a[i+1].key && a[i].seq > a[i+1].seq)
+            return "NO";
+    }
+    return "ok";
+}
+
+/* * * * * * * * * * * * * * external merge sort  * * * * * * * * * * * * * * * */
+
+/** *******************************************************************************
+ * a sorted run of the external sort, read through two buffers: the merge         *
+ * consumes one while the I/O thread refills the other                            *
+ *********************************************************************************/
+typedef struct extRun {
+    FILE * file;          /**< temporary file holding the run                  */
+    int * buf [2];        /**< the two read buffers                            */
+    int length [2];       /**< elements in each buffer; 0 at the end of the run */
+    bool ready [2];       /**< whether each buffer has been filled             */
+    int active;           /**< the buffer being consumed                       */
+    int pos;              /**< next element of the active buffer               */
+} extRun;
+
+/** *******************************************************************************
+ * state shared by the merge and its I/O thread: a queue of run buffers to be     *
+ * refilled, and the one output buffer waiting to be written                      *
+ *********************************************************************************/
+typedef struct extIO {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;   /**< signaled when a buffer is filled or written   */
+    extRun * runs;
+    int bufferInts;           /**< capacity of every buffer, in elements         */
+    int * queue;              /**< run*2 + buffer index of buffers to refill     */
+    int queueHead, queueTail, queueSize;
+    FILE * out;
+    int * pending;            /**< output buffer being written, or NULL          */
+    int pendingLength;
+    bool done;                /**< the merge has finished with the I/O thread    */
+    bool failed;              /**< a read or write came up short with an error   */
+} extIO;
+
+/** *******************************************************************************
+ * I/O thread of the external merge: writes output buffers and refills run        *
+ * buffers while the merge works on the others                                    *
+ * @remark  a short write, or a short read with the file's error set, sets        *
+ *          io->failed; the failed read ends its run, so the merge still          *
+ *          finishes, and reports the failure                                     *
+ *********************************************************************************/
+void * extIOThread (void * arg) {
+    extIO * io = (extIO *) arg;
+
+    pthread_mutex_lock (&io->lock);
+    while (1) {
+        while (!io->done && io->pending == NULL && io->queueHead == io->queueTail)
+            pthread_cond_wait (&io->changed, &io->lock);
+
+        if (io->pending != NULL) {
+            int * data = io->pending;
+            int length = io->pendingLength;
+            pthread_mutex_unlock (&io->lock);
+            size_t written = fwrite (data, sizeof(int), length, io->out);
+            pthread_mutex_lock (&io->lock);
+            if (written != (size_t) length)
+                io->failed = true;
+            io->pending = NULL;
+            pthread_cond_broadcast (&io->changed);
+        } else if (io->queueHead != io->queueTail) {
+            int entry = io->queue[io->queueHead];
+            io->queueHead = (io->queueHead + 1) % io->queueSize;
+            extRun * run = &io->runs[entry / 2];
+            int b = entry % 2;
+            pthread_mutex_unlock (&io->lock);
+            int length = fread (run->buf[b], sizeof(int), io->bufferInts, run->file);
+            bool error = length < io->bufferInts && ferror (run->file);
+            pthread_mutex_lock (&io->lock);
+            if (error) {
+                io->failed = true;
+                length = 0;
+            }
+            run->length[b] = length;
+            run->ready[b] = true;
+            pthread_cond_broadcast (&io->changed);
+        } else {
+            break;
+        }
+    }
+    pthread_mutex_unlock (&io->lock);
+    return NULL;
+}
+
+/** *******************************************************************************
+ * queue buffer b of run r for refilling; the caller holds io->lock               *
+ *********************************************************************************/
+void extRequestFill (extIO * io, int r, int b) {
+    io->runs[r].ready[b] = false;
+    io->queue[io->queueTail] = 2 * r + b;
+    io->queueTail = (io->queueTail + 1) % io->queueSize;
+    pthread_cond_broadcast (&io->changed);
+}
+
+/** *******************************************************************************
+ * make the next element of run r available, switching to its other buffer        *
+ * once the active one is used up                                                 *
+ * @returns  false once the run is exhausted                                      *
+ *********************************************************************************/
+bool extAdvance (extIO * io, int r) {
+    extRun * run = &io->runs[r];
+    if (run->pos < run->length[run->active])
+        return true;
+
+    pthread_mutex_lock (&io->lock);
+    int used = run->active;
+    run->active = 1 - used;
+    run->pos = 0;
+    while (!run->ready[run->active])
+        pthread_cond_wait (&io->changed, &io->lock);
+    if (run->length[run->active] > 0)
+        extRequestFill (io, r, used);
+    pthread_mutex_unlock (&io->lock);
+    return run->length[run->active] > 0;
+}
+
+/** *******************************************************************************
+ * hand a full output buffer to the I/O thread, once it has written the last one  *
+ *********************************************************************************/
+void extWrite (extIO * io, int * data, int length) {
+    pthread_mutex_lock (&io->lock);
+    while (io->pending != NULL)
+        pthread_cond_wait (&io->changed, &io->lock);
+    io->pending = data;
+    io->pendingLength = length;
+    pthread_cond_broadcast (&io->changed);
+    pthread_mutex_unlock (&io->lock);
+}
+
+/** *******************************************************************************
+ * merge sorted runs from files into out with a loser tree, as loserTreeMerge     *
+ * does in memory, with double-buffered reads of every run and double-buffered    *
+ * writes                                                                         *
+ * @param  files  the runs, each positioned at its start                          *
+ * @param  numRuns  the number of runs, at most externalFanIn                     *
+ * @param  out  the file receiving the merged result                              *
+ * @param  memoryInts  memory for all the buffers, in elements                    *
+ * @returns  the number of elements written, or -1 if a read or write failed      *
+ *********************************************************************************/
+long long externalMerge (FILE * files [ ], int numRuns, FILE * out, long long memoryInts) {
+    long long bufferInts = memoryInts / (2 * numRuns + 2);
+    if (bufferInts > INT_MAX)
+        bufferInts = INT_MAX;
+    if (bufferInts < 1024)
+        bufferInts = 1024;
+
+    extIO io;
+    pthread_mutex_init (&io.lock, NULL);
+    pthread_cond_init (&io.changed, NULL);
+    io.runs = (extRun *) malloc (numRuns * sizeof(extRun));
+    io.bufferInts = (int) bufferInts;
+    io.queueSize = 2 * numRuns + 1;
+    io.queue = (int *) malloc (io.queueSize * sizeof(int));
+    io.queueHead = io.queueTail = 0;
+    io.out = out;
+    io.pending = NULL;
+    io.done = false;
+    io.failed = false;
+
+    for (int r = 0; r < numRuns; r++) {
+        io.runs[r].file = files[r];
+        io.runs[r].buf[0] = (int *) malloc (bufferInts * sizeof(int));
+        io.runs[r].buf[1] = (int *) malloc (bufferInts * sizeof(int));
+        io.runs[r].length[0] = io.runs[r].length[1] = 0;
+        io.runs[r].active = 0;
+        io.runs[r].pos = 0;
+        extRequestFill (&io, r, 0);
+        extRequestFill (&io, r, 1);
+    }
+    int * outBuf [2];
+    outBuf[0] = (int *) malloc (bufferInts * sizeof(int));
+    outBuf[1] = (int *) malloc (bufferInts * sizeof(int));
+    int outActive = 0, outPos = 0;
+
+    pthread_t ioThread;
+    pthread_create (&ioThread, NULL, extIOThread, &io);
+
+    // leaves are padded to a power of two with empty runs
+    int leaves = 1;
+    while (leaves < numRuns)
+        leaves *= 2;
+    int * key = (int *) malloc (leaves * sizeof(int));
+    bool * done = (bool *) malloc (leaves * sizeof(bool));
+    int * tree = (int *) malloc (leaves * sizeof(int));
+    int * winner = (int *) malloc (2 * leaves * sizeof(int));
+    for (int r = 0; r < leaves; r++) {
+        done[r] = true;
+        if (r < numRuns) {
+            pthread_mutex_lock (&io.lock);
+            while (!io.runs[r].ready[0])
+                pthread_cond_wait (&io.changed, &io.lock);
+            pthread_mutex_unlock (&io.lock);
+            done[r] = io.runs[r].length[0] == 0;
+        }
+        key[r] = done[r] ? INT_MAX : io.runs[r].buf[0][0];
+    }
+
+    // play the initial tournament, keeping the loser of each match
+    for (int r = 0; r < leaves; r++)
+        winner[leaves + r] = r;
+    for (int node = leaves - 1; node >= 1; node--) {
+        int left = winner[2*node];
+        int right = winner[2*node + 1];
+        if (loserBeats (key, done, left, right)) {
+            winner[node] = left;
+            tree[node] = right;
+        } else {
+            winner[node] = right;
+            tree[node] = left;
+        }
+    }
+    tree[0] = winner[1];
+
+    // output winners until every run is exhausted
+    long long count = 0;
+    while (!done[tree[0]]) {
+        int w = tree[0];
+        extRun * run = &io.runs[w];
+        outBuf[outActive][outPos++] = key[w];
+        count++;
+        if (outPos == bufferInts) {
+            extWrite (&io, outBuf[outActive], outPos);
+            outActive = 1 - outActive;
+            outPos = 0;
+        }
+
+        run->pos++;
+        if (extAdvance (&io, w))
+            key[w] = run->buf[run->active][run->pos];
+        else {
+            key[w] = INT_MAX;
+            done[w] = true;
+        }
+        for (int node = (w + leaves) / 2; node >= 1; node /= 2) {
+            if (loserBeats (key, done, tree[node], w)) {
+                int temp = tree[node];
+                tree[node] = w;
+                w = temp;
+            }
+        }
+        tree[0] = w;
+    }
+    if (outPos > 0)
+        extWrite (&io, outBuf[outActive], outPos);
+
+    // let the I/O thread finish the last write and any refills still queued
+    pthread_mutex_lock (&io.lock);
+    io.done = true;
+    pthread_cond_broadcast (&io.changed);
+    pthread_mutex_unlock (&io.lock);
+    pthread_join (ioThread, NULL);
+    bool failed = io.failed || fflush (out) != 0 || ferror (out);
+
+    for (int r = 0; r < numRuns; r++) {
+        free (io.runs[r].buf[0]);
+        free (io.runs[r].buf[1]);
+    }
+    free (io.runs);
+    free (io.queue);
+    free (outBuf[0]);
+    free (outBuf[1]);
+    free (key);
+    free (done);
+    free (tree);
+    free (winner);
+    pthread_mutex_destroy (&io.lock);
+    pthread_cond_destroy (&io.changed);
+    return failed ? -1 : count;
+}
+
+/** *******************************************************************************
+ * open a temporary file for a run, removed as soon as it is closed               *
+ * @param  dir  the directory to hold it; runs go on disk there, not in /tmp,     *
+ *              which is often a file system kept in memory                       *
+ * @returns  the file, or NULL after printing why it could not be made            *
+ *********************************************************************************/
+FILE * externalTempFile (char * dir) {
+    char name [4096];
+    snprintf (name, sizeof(name), "%s/external-sort-XXXXXX", dir);
+    int fd = mkstemp (name);
+    if (fd < 0) {
+        perror (name);
+        return NULL;
+    }
+    unlink (name);
+    FILE * file = fdopen (fd, "w+b");
+    if (file == NULL) {
+        perror (name);
+        close (fd);
+    }
+    return file;
+}
+
+/* close the temporary files of runs[first..last-1] */
+void closeRuns (FILE * runs [ ], int first, int last) {
+    for (int r = first; r < last; r++)
+        fclose (runs[r]);
+}
+
+/** *******************************************************************************
+ * external merge sort of a binary file of native ints, using about memoryBytes   *
+ * of memory however large the file: chunks that fit are sorted in place by the   *
+ * American flag sort, which needs no second buffer, and spilled to temporary     *
+ * files as runs, then merged externalFanIn runs at a time                        *
+ * until one pass can merge the rest into the output file                         *
+ * @param  inName  the file to be sorted                                          *
+ * @param  outName  the file receiving the sorted data                            *
+ * @param  tempDir  the directory for the runs, or NULL for that of outName       *
+ * @param  memoryBytes  memory to use for chunks and buffers                      *
+ * @param  numRuns  set to the number of runs formed                              *
+ * @param  mergePasses  set to the number of merge passes                         *
+ * @returns  the number of elements sorted, or -1 if a file could not be used     *
+ *           or a read or write fell short, as on a full disk                     *
+ *********************************************************************************/
+long long externalSort (char * inName, char * outName, char * tempDir,
+                        long long memoryBytes, int * numRuns, int * mergePasses) {
+    struct stat info;
+    if (stat (inName, &info) == 0 && info.st_size % sizeof(int) != 0) {
+        printf ("%s: size is not a multiple of %zu bytes\n", inName, sizeof(int));
+        return -1;
+    }
+    char outDir [4096];
+    if (tempDir == NULL) {
+        snprintf (outDir, sizeof(outDir), "%s", outName);
+        char * slash = strrchr (outDir, '/');
+        if (slash == NULL)
+            strcpy (outDir, ".");
+        else if (slash == outDir)
+            outDir[1] = '\0';
+        else
+            *slash = '\0';
+        tempDir = outDir;
+    }
+    FILE * in = fopen (inName, "rb");
+    if (in == NULL) {
+        perror (inName);
+        return -1;
+    }
+    long long chunkInts = memoryBytes / sizeof(int);
+    if (chunkInts > INT_MAX)
+        chunkInts = INT_MAX;
+    int * chunk = (int *) malloc (chunkInts * sizeof(int));
+    if (chunk == NULL) {
+        printf ("cannot allocate %lld bytes for the external sort\n", memoryBytes);
+        fclose (in);
+        return -1;
+    }
+
+    // form the runs
+    int runCapacity = 16;
+    FILE ** runs = (FILE **) malloc (runCapacity * sizeof(FILE *));
+    int count = 0;
+    long long total = 0;
+    int length;
+    bool failed = false;
+    while ((length = fread (chunk, sizeof(int), chunkInts, in)) > 0) {
+        americanFlagSort (chunk, length);
+        if (count == runCapacity) {
+            runCapacity *= 2;
+            runs = (FILE **) realloc (runs, runCapacity * sizeof(FILE *));
+        }
+        runs[count] = externalTempFile (tempDir);
+        if (runs[count] == NULL) {
+            failed = true;
+            break;
+        }
+        count++;
+        if (fwrite (chunk, sizeof(int), length, runs[count-1]) != (size_t) length
+            || fflush (runs[count-1]) != 0) {
+            perror ("external sort run");
+            failed = true;
+            break;
+        }
+        rewind (runs[count-1]);
+        total += length;
+    }
+    // fread stops short at the end of the file, or on an error
+    if (!failed && ferror (in)) {
+        perror (inName);
+        failed = true;
+    }
+    fclose (in);
+    free (chunk);
+    if (failed) {
+        closeRuns (runs, 0, count);
+        free (runs);
+        return -1;
+    }
+    *numRuns = count;
+    *mergePasses = 0;
+
+    // merge groups of runs into longer runs until one pass is enough
+    while (count > externalFanIn) {
+        int newCount = 0;
+        for (int first = 0; first < count; first += externalFanIn) {
+            int k = (count - first < externalFanIn) ? count - first : externalFanIn;
+            FILE * merged = externalTempFile (tempDir);
+            if (merged == NULL
+                || externalMerge (runs + first, k, merged, memoryBytes / sizeof(int)) < 0) {
+                if (merged != NULL) {
+                    printf ("external sort:  merging runs in %s failed\n", tempDir);
+                    fclose (merged);
+                }
+                // runs[0..newCount-1] are this pass's output, runs[first..] its input
+                closeRuns (runs, 0, newCount);
+                closeRuns (runs, first, count);
+                free (runs);
+                return -1;
             }
+            closeRuns (runs, first, first + k);
+            rewind (merged);
+            runs[newCount++] = merged;
+        }
+        count = newCount;
+        (*mergePasses)++;
+    }
 
-            printf ("\n");
+    FILE * out = fopen (outName, "wb");
+    if (out == NULL) {
+        perror (outName);
+        closeRuns (runs, 0, count);
+        free (runs);
+        return -1;
+    }
+    long long written = externalMerge (runs, count, out, memoryBytes / sizeof(int));
+    if (count > 0)
+        (*mergePasses)++;
+    closeRuns (runs, 0, count);
+    free (runs);
+    if (fclose (out) != 0 || written != total) {
+        if (written < 0)
+            printf ("%s:  a read or write failed, so the output is incomplete\n", outName);
+        else
+            printf ("%s:  wrote %lld of %lld elements\n", outName, written, total);
+        return -1;
+    }
+    return total;
+}
 
+/** *******************************************************************************
+ * check a binary file of native ints holds n elements in non-descending order    *
+ * @param  name  the file to be checked                                           *
+ * @param  n     the number of elements it must hold                              *
+ * returns  "ok" if it holds n elements in non-descending order; "NO" otherwise   *
+ *********************************************************************************/
+char * checkFileAscending (char * name, long long n) {
+    FILE * file = fopen (name, "rb");
+    if (file == NULL)
+        return "NO";
+    #define checkBufferInts  (1 << 20)
+    int * buf = (int *) malloc (checkBufferInts * sizeof(int));
+    int previous = INT_MIN;
+    char * result = "ok";
+    long long count = 0;
+    int length;
+    while ((length = fread (buf, sizeof(int), checkBufferInts, file)) > 0) {
+        for (int i = 0; i < length; i++) {
+            if (buf[i] < previous)
+                result = "NO";
+            previous = buf[i];
         }
+        count += length;
+    }
+    if (count != n || ferror (file))
+        result = "NO";
+    free (buf);
+    fclose (file);
+    return result;
+}
+
+/* * * * * * * * * * memory-mapped binary data files  * * * * * * * * * * * * */
+
+/** *******************************************************************************
+ * map a file of raw int32 or int64 values, little-endian as on the hosts we run  *
+ * on, for sorting in place without reading or parsing it                         *
+ * @remark  the mapping is private, so sorts write to copy-on-write pages and     *
+ *          the file itself never changes; mapping the file again gives the       *
+ *          original data for the next sort, with no copy taken                   *
+ * @param  name  the file to be mapped                                            *
+ * @param  elemSize  4 for int32 data, 8 for int64 data                           *
+ * @param  n  set to the number of elements in the file                           *
+ * @returns  the mapped elements, or NULL if the file could not be mapped         *
+ *********************************************************************************/
+void * mapIntFile (char * name, size_t elemSize, long long * n) {
+    int fd = open (name, O_RDONLY);
+    if (fd < 0) {
+        perror (name);
+        return NULL;
+    }
+    struct stat info;
+    if (fstat (fd, &info) < 0 || info.st_size == 0 || info.st_size % elemSize != 0) {
+        printf ("%s: size is not a positive multiple of %zu bytes\n", name, elemSize);
+        close (fd);
+        return NULL;
+    }
+    void * data = mmap (NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED) {
+        perror (name);
+        return NULL;
+    }
+    madvise (data, info.st_size, MADV_SEQUENTIAL);
+    madvise (data, info.st_size, MADV_WILLNEED);
+    *n = info.st_size / elemSize;
+    return data;
+}
+
+/** *******************************************************************************
+ * write raw elements to a file through a shared mapping of it                    *
+ * @param  name  the file to be written, created or truncated                     *
+ * @param  data  the elements                                                     *
+ * @param  bytes  the size of the elements in bytes                               *
+ * @returns  0 on success, -1 if the file could not be written                    *
+ *********************************************************************************/
+int saveIntFile (char * name, void * data, size_t bytes) {
+    int fd = open (name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate (fd, bytes) < 0) {
+        perror (name);
+        if (fd >= 0)
+            close (fd);
+        return -1;
+    }
+    void * out = mmap (NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    if (out == MAP_FAILED) {
+        perror (name);
+        return -1;
+    }
+    madvise (out, bytes, MADV_SEQUENTIAL);
+    memcpy (out, data, bytes);
+    munmap (out, bytes);
+    return 0;
+}
 
-        // clean up copies of test arrays
-        free (tempAsc);
-        free (tempRan);
-        free (tempDes);
+/* * * * random data for each element type, for the typed sort driver  * * * */
 
-        // clean up original test arrays
-        free (asc);
-        free (ran);
-        free (des);
+/** *******************************************************************************
+ * 64 random bits from rand(), which gives at least 15 bits per call              *
+ *********************************************************************************/
+unsigned long long rand64 ( ) {
+    unsigned long long bits = 0;
+    for (int i = 0; i < 5; i++)
+        bits = (bits << 15) ^ (unsigned long long) rand ();
+    return bits;
+}
+
+void fillRandom_i32 (void * a, int n) {
+    for (int i = 0; i < n; i++)
+        ((int *) a)[i] = (int) rand64 ();
+}
 
-    } // end of loop for testing procedures with different array sizes
+void fillRandom_i64 (void * a, int n) {
+    for (int i = 0; i < n; i++)
+        ((long long *) a)[i] = (long long) rand64 ();
+}
 
+void fillRandom_u64 (void * a, int n) {
+    for (int i = 0; i < n; i++)
+        ((unsigned long long *) a)[i] = rand64 ();
+}
+
+void fillRandom_f64 (void * a, int n) {
+    for (int i = 0; i < n; i++)
+        ((double *) a)[i] = (rand () / (double) RAND_MAX - 0.5) * 1e6;
+}
+
+void fillRandom_f32 (void * a, int n) {
+    for (int i = 0; i < n; i++)
+        ((float *) a)[i] = (float) ((rand () / (double) RAND_MAX - 0.5) * 1e6);
+}
+
+/** *******************************************************************************
+ * fill with pointers to random 11-letter strings, kept in a buffer that is       *
+ * reused by the next call                                                        *
+ *********************************************************************************/
+void fillRandom_str (void * a, int n) {
+    static char * text = NULL;
+    text = (char *) realloc (text, n * 12);
+    for (int i = 0; i < n; i++) {
+        char * word = text + 12 * i;
+        for (int c = 0; c < 11; c++)
+            word[c] = 'a' + rand () % 26;
+        word[11] = '\0';
+        ((char **) a)[i] = word;
+    }
+}
+
+/* * * * * * * * * * * * procedures to check sorting correctness  * * * * * * * * */
+
+
+/** *******************************************************************************
+ * check all array elements are in non-descending order                           *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * returns  "ok" if array elements in non-descending order; "NO" otherwise        *
+ *********************************************************************************/
+char * checkAscending (int a [ ], int n) {
+    for (int i = 0; i < n-1; i++) {
+        if (a[i] > a[i+1])
+            return "NO";
+    }
+    return "ok";
+}
+
+/* * * * * * * * * * * drivers for the other benchmark modes  * * * * * * * * * * */
+
+/** *******************************************************************************
+ * start a row of the benchmark table for a driver timing its own sorts           *
+ * @param  r          the row, cleared                                            *
+ * @param  algorithm  the algorithm's name; trailing blanks are dropped           *
+ * @param  detail     added after the name, as the element type, or ""            *
+ * @param  shape      the name of the data set                                    *
+ * @param  n          elements sorted                                             *
+ *********************************************************************************/
+void startResult (benchResult * r, char * algorithm, char * detail, char * shape,
+                  long long n) {
+    memset (r, 0, sizeof(benchResult));
+    int length = strlen (algorithm);
+    while (length > 0 && algorithm[length-1] == ' ')
+        length--;
+    snprintf (r->algorithm, sizeof(r->algorithm), "%.*s%s%s", length, algorithm,
+              (*detail != '\0') ? " " : "", detail);
+    snprintf (r->shape, sizeof(r->shape), "%s", shape);
+    r->n = n;
+}
+
+/** *******************************************************************************
+ * a run of one of the other modes' sorts on a copy of its input, for             *
+ * benchMeasure; each mode sets the fields its run uses                           *
+ *********************************************************************************/
+typedef struct copyTrial {
+    void * input;                         /**< the data, left unchanged            */
+    void * work;                          /**< the copy sorted                     */
+    size_t bytes;                         /**< bytes copied before each run        */
+    int n;                                /**< elements sorted                     */
+    void (*sortProc) (void *, int);       /**< an untyped sort, or NULL            */
+    void (*keyedProc) (keyedItem [ ], int);/**< a sort of keyed items, or NULL     */
+    struct recordSorts * records;         /**< the argsort driver's row, or NULL   */
+    int * perm;                           /**< the argsort permutation             */
+} copyTrial;
+
+/* copy the input over the last run's output */
+void copyInput (void * context) {
+    copyTrial * t = (copyTrial *) context;
+    memcpy (t->work, t->input, t->bytes);
+}
+
+void runSort (void * context) {
+    copyTrial * t = (copyTrial *) context;
+    if (t->sortProc != NULL)
+        t->sortProc (t->work, t->n);
+    else
+        t->keyedProc ((keyedItem *) t->work, t->n);
+}
+
+/** *******************************************************************************
+ * collect the arguments of a mode, leaving out the --options of the harness      *
+ * @returns  the number of arguments, including the program name and mode         *
+ *********************************************************************************/
+int modeArgs (int argc, char * argv [ ], char * args [ ]) {
+    int num = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp (argv[i], "--", 2) != 0)
+            args[num++] = argv[i];
+    }
+    return num;
+}
+
+/** *******************************************************************************
+ * driver for timing the typed sorts on random data of each element type          *
+ * every algorithm of one type sorts copies of the same random data               *
+ **********************************************************************************/
+int typedDriver (int argc, char * argv [ ]) {
+    // one row per algorithm and element type
+    #define typedRows(T, type)                                                        \
+        {"heap sort     ", #T, sizeof(type), heapSort_##T##_v, fillRandom_##T,        \
+         checkAscending_##T##_v},                                                     \
+        {"merge sort    ", #T, sizeof(type), mergeSort_##T##_v, fillRandom_##T,       \
+         checkAscending_##T##_v},                                                     \
+        {"introsort     ", #T, sizeof(type), introsort_##T##_v, fillRandom_##T,       \
+         checkAscending_##T##_v}
+    #define numTyped  19
+    typedSorts typedProcs [numTyped] = {typedRows (i32, int),
+                                        {"generic merge ", "i32", sizeof(int),
+                                         genericMergeSort_i32_v, fillRandom_i32,
+                                         checkAscending_i32_v},
+                                        typedRows (i64, long long),
+                                        typedRows (u64, unsigned long long),
+                                        typedRows (f64, double),
+                                        typedRows (f32, float),
+                                        typedRows (str, char *)};
+    int maxTypedSize = 5120000;
+
+    benchInit (10000, maxTypedSize, 2);
+    benchConf.trials = 3;
+    if (benchBegin (argc, argv) != 0)
+        return 1;
+    srand (benchConf.seed);
+
+    for (int size = benchConf.minSize; size <= benchConf.maxSize; size *= benchConf.factor) {
+        printf ("\n");
+        char * orig = (char *) malloc (size * sizeof(long long));
+        char * temp = (char *) malloc (size * sizeof(long long));
+        char * lastType = "";
+
+        for (int alg = 0; alg < numTyped; alg++) {
+            typedSorts * ts = &typedProcs[alg];
+            benchResult result;
+            startResult (&result, ts->name, ts->typeName, "random", size);
+            if (!benchMatches (result.algorithm, benchConf.algFilter))
+                continue;
+
+            // new random data whenever the element type changes
+            if (strcmp (ts->typeName, lastType) != 0) {
+                ts->fillProc (orig, size);
+                lastType = ts->typeName;
+            }
+            copyTrial trial = {.input = orig, .work = temp, .bytes = size * ts->elemSize,
+                               .n = size, .sortProc = ts->sortProc};
+            benchMeasure (copyInput, runSort, &trial, &result);
+            result.check = ts->checkProc (temp, size);
+            benchReport (&result);
+        }
+
+        free (orig);
+        free (temp);
+    }
+    benchEnd ();
     return 0;
 }
+
+/** *******************************************************************************
+ * structure to identify a sorting algorithm for the argsort driver:              *
+ * the algorithm sorting records directly, and its index and pair versions        *
+ *********************************************************************************/
+typedef struct recordSorts {
+    char * name;                             /**< the algorithm and record size     */
+    size_t recordSize;                       /**< bytes per record                  */
+    void (*directProc) (void *, int);        /**< sorts the records themselves      */
+    void (*indexProc) (int [ ], int);        /**< sorts indices, for argsortIndex   */
+    void (*pairProc) (keyIndex [ ], int);    /**< sorts pairs, for argsortCached    */
+} recordSorts;
+
+/** *******************************************************************************
+ * check records are in key order and each payload still matches its key          *
+ * @param  records     the records, as filled by the argsort driver               *
+ * @param  n           the number of records                                      *
+ * @param  recordSize  bytes per record                                           *
+ * returns  "ok" if the records are sorted and intact; "NO" otherwise             *
+ *********************************************************************************/
+char * checkRecords (void * records, int n, size_t recordSize) {
+    char * rec = (char *) records;
+    for (int i = 0; i < n; i++) {
+        long long key = * (long long *) (rec + i * recordSize);
+        if (i > 0 && key < * (long long *) (rec + (i-1) * recordSize))
+            return "NO";
+        if (rec[i * recordSize + recordSize - 1] != (char) key)
+            return "NO";
+    }
+    return "ok";
+}
+
+/* the argsort driver's runs: records sorted directly, and by argsort, by index
+   or with cached keys, then moved once by applyPermutation */
+void runDirect (void * context) {
+    copyTrial * t = (copyTrial *) context;
+    t->records->directProc (t->work, t->n);
+}
+
+void runArgsort (void * context) {
+    copyTrial * t = (copyTrial *) context;
+    size_t bytes = t->records->recordSize;
+    argsortIndex (t->work, t->n, bytes, t->records->indexProc, t->perm);
+    applyPermutation (t->work, t->n, bytes, t->perm);
+}
+
+void runCached (void * context) {
+    copyTrial * t = (copyTrial *) context;
+    size_t bytes = t->records->recordSize;
+    argsortCached (t->work, t->n, bytes, t->records->pairProc, t->perm);
+    applyPermutation (t->work, t->n, bytes, t->perm);
+}
+
+/** *******************************************************************************
+ * driver timing direct sorts of wide records against argsort, by index and       *
+ * with cached keys, each followed by applyPermutation                            *
+ **********************************************************************************/
+int argsortDriver (int argc, char * argv [ ]) {
+    #define recordRows(T, bytes)                                                      \
+        {"heap sort " #bytes, sizeof(record##bytes), heapSort_##T##_v,                \
+         heapSort_idx, heapSort_ki},                                                  \
+        {"merge sort " #bytes, sizeof(record##bytes), mergeSort_##T##_v,              \
+         mergeSort_idx, mergeSort_ki},                                                \
+        {"introsort " #bytes, sizeof(record##bytes), introsort_##T##_v,               \
+         introsort_idx, introsort_ki}
+    #define numRecordSorts  9
+    recordSorts recordProcs [numRecordSorts] = {recordRows (rec64, 64),
+                                                recordRows (rec128, 128),
+                                                recordRows (rec256, 256)};
+    int maxRecordSize = 1280000;
+
+    benchInit (10000, maxRecordSize, 2);
+    benchConf.trials = 3;
+    if (benchBegin (argc, argv) != 0)
+        return 1;
+    srand (benchConf.seed);
+
+    for (int size = benchConf.minSize; size <= benchConf.maxSize; size *= benchConf.factor) {
+        printf ("\n");
+        char * orig = (char *) malloc (size * sizeof(record256));
+        char * temp = (char *) malloc (size * sizeof(record256));
+        int * perm = (int *) malloc (size * sizeof(int));
+
+        for (int alg = 0; alg < numRecordSorts; alg++) {
+            recordSorts * rs = &recordProcs[alg];
+            size_t bytes = rs->recordSize;
+            if (!benchMatches (rs->name, benchConf.algFilter))
+                continue;
+
+            // random keys; the payload repeats the key's low byte
+            for (int i = 0; i < size; i++) {
+                long long key = (long long) rand64 ();
+                memcpy (orig + i * bytes, &key, sizeof(key));
+                memset (orig + i * bytes + sizeof(key), (char) key, bytes - sizeof(key));
+            }
+            copyTrial trial = {.input = orig, .work = temp, .bytes = size * bytes,
+                               .n = size, .records = rs, .perm = perm};
+            benchResult result;
+
+            // records sorted directly, by index, and by (key, index) pairs
+            char * methods [3] = {"direct", "argsort", "cached"};
+            void (*runs [3]) (void *) = {runDirect, runArgsort, runCached};
+            for (int m = 0; m < 3; m++) {
+                startResult (&result, rs->name, methods[m], "random", size);
+                benchMeasure (copyInput, runs[m], &trial, &result);
+                result.check = checkRecords (temp, size, bytes);
+                benchReport (&result);
+            }
+        }
+
+        free (orig);
+        free (temp);
+        free (perm);
+    }
+    benchEnd ();
+    return 0;
+}
+
+/** *******************************************************************************
+ * driver checking which engines sort stably, on items with only 100 distinct     *
+ * keys, so most items share their key with many others; the check column         *
+ * reports whether the sort kept items of equal keys in their original order      *
+ **********************************************************************************/
+int stableDriver (int argc, char * argv [ ]) {
+    #define numKeyed  4
+    struct {
+        char * name;
+        void (*sortProc) (keyedItem [ ], int);
+    } keyedProcs [numKeyed] = {{"heap sort     ", heapSort_kv},
+                               {"introsort     ", introsort_kv},
+                               {"merge sort    ", mergeSort_kv},
+                               {"powersort     ", stableSort_kv}};
+
+    benchInit (10000, 5120000, 2);
+    benchConf.trials = 3;
+    if (benchBegin (argc, argv) != 0)
+        return 1;
+    srand (benchConf.seed);
+
+    for (int size = benchConf.minSize; size <= benchConf.maxSize; size *= benchConf.factor) {
+        printf ("\n");
+        keyedItem * orig = (keyedItem *) malloc (size * sizeof(keyedItem));
+        keyedItem * temp = (keyedItem *) malloc (size * sizeof(keyedItem));
+        for (int i = 0; i < size; i++) {
+            orig[i].key = rand () % 100;
+            orig[i].seq = i;
+        }
+
+        for (int alg = 0; alg < numKeyed; alg++) {
+            benchResult result;
+            startResult (&result, keyedProcs[alg].name, "", "100 keys", size);
+            if (!benchMatches (result.algorithm, benchConf.algFilter))
+                continue;
+            copyTrial trial = {.input = orig, .work = temp, .bytes = size * sizeof(keyedItem),
+                               .n = size, .keyedProc = keyedProcs[alg].sortProc};
+            benchMeasure (copyInput, runSort, &trial, &result);
+            result.check = checkStable (temp, size);
+            benchReport (&result);
+        }
+
+        free (orig);
+        free (temp);
+    }
+    benchEnd ();
+    return 0;
+}
+
+/** *******************************************************************************
+ * a run of the external sort, for benchMeasure; the sort rewrites the output     *
+ * file each run, so a run needs no preparation                                   *
+ *********************************************************************************/
+typedef struct externalTrial {
+    char * inName;               /**< the file to sort                            */
+    char * outName;              /**< the file receiving the sorted data          */
+    char * tempDir;              /**< the directory for the runs, or NULL         */
+    long long memoryBytes;       /**< memory the sort may use                     */
+    long long n;                 /**< elements sorted, or -1 after a failure      */
+    int numRuns;                 /**< sorted runs written                         */
+    int mergePasses;             /**< passes merging the runs                     */
+} externalTrial;
+
+void prepareNothing (void * context) {
+    (void) context;
+}
+
+/* sort the file, unless an earlier run has failed and printed why */
+void runExternal (void * context) {
+    externalTrial * t = (externalTrial *) context;
+    if (t->n >= 0)
+        t->n = externalSort (t->inName, t->outName, t->tempDir, t->memoryBytes,
+                             &t->numRuns, &t->mergePasses);
+}
+
+/** *******************************************************************************
+ * driver for the external merge sort of a binary file of native ints             *
+ * usage:  external  input-file  output-file  [megabytes of memory]               *
+ *                   [directory for the runs]  [--options]                        *
+ * the runs go in the output file's directory unless another is given             *
+ **********************************************************************************/
+int externalDriver (int argc, char * argv [ ]) {
+    char * args [argc];
+    int num = modeArgs (argc, argv, args);
+    if (num < 4) {
+        printf ("usage:  %s external input-file output-file [megabytes] [run-directory]\n",
+                argv[0]);
+        return 1;
+    }
+    long long megabytes = (num > 4) ? atoll (args[4]) : externalMB;
+    if (megabytes < 1)
+        megabytes = 1;
+    char * tempDir = (num > 5) ? args[5] : NULL;
+
+    // a write past a file size limit then fails, and is reported, rather than
+    // ending the program with SIGXFSZ
+    signal (SIGXFSZ, SIG_IGN);
+
+    benchInit (1, 1, 2);
+    benchConf.trials = 3;
+    if (benchBegin (argc, argv) != 0)
+        return 1;
+    printf ("\n");
+
+    externalTrial trial = {.inName = args[2], .outName = args[3], .tempDir = tempDir,
+                           .memoryBytes = megabytes * 1024 * 1024};
+    benchResult result;
+    startResult (&result, "external sort", "", "int32 file", 0);
+    benchMeasure (prepareNothing, runExternal, &trial, &result);
+    if (trial.n < 0) {
+        benchEnd ();
+        return 1;
+    }
+    result.n = trial.n;
+    result.check = checkFileAscending (args[3], trial.n);
+    snprintf (result.note, sizeof(result.note), "  %d runs %d merge passes %lld MB",
+              trial.numRuns, trial.mergePasses, megabytes);
+    benchReport (&result);
+    benchEnd ();
+    return 0;
+}
+
+/** *******************************************************************************
+ * a run of a sort on the data of a file, for benchMeasure; the file is mapped    *
+ * privately, so each run sorts a fresh mapping and leaves the file unchanged     *
+ *********************************************************************************/
+typedef struct fileTrial {
+    char * name;                          /**< the file                            */
+    size_t elemSize;                      /**< bytes per element                   */
+    void * data;                          /**< the mapping, or NULL                */
+    long long n;                          /**< elements in the file                */
+    void (*wideProc) (void *, int);       /**< a sort of int64 data, or NULL       */
+    void (*intProc) (int [ ], int);       /**< a sort of int32 data, or NULL       */
+} fileTrial;
+
+/* map the file afresh, dropping the last run's sorted mapping, and write to each
+   page once so the copy-on-write faults fall here rather than in the timed sort */
+void remapFile (void * context) {
+    fileTrial * t = (fileTrial *) context;
+    if (t->data != NULL)
+        munmap (t->data, t->n * t->elemSize);
+    t->data = mapIntFile (t->name, t->elemSize, &t->n);
+    if (t->data == NULL)
+        return;
+    volatile char * bytes = (volatile char *) t->data;
+    size_t size = t->n * t->elemSize;
+    size_t page = (size_t) sysconf (_SC_PAGESIZE);
+    for (size_t b = 0; b < size; b += page)
+        bytes[b] = bytes[b];
+}
+
+void runFileSort (void * context) {
+    fileTrial * t = (fileTrial *) context;
+    if (t->data == NULL)
+        return;
+    if (t->wideProc != NULL)
+        t->wideProc (t->data, t->n);
+    else
+        t->intProc ((int *) t->data, t->n);
+}
+
+/** *******************************************************************************
+ * driver timing sorts on the data of a binary file, mapped afresh for each run   *
+ * usage:  file  input-file  [int32 | int64]  [output-file]  [--options]          *
+ * int32 data is sorted by every algorithm of the main table, int64 data by the   *
+ * typed sorts; the output file receives the data sorted by the last algorithm    *
+ * that ran; the pages are faulted in before each run, so times leave that out    *
+ **********************************************************************************/
+int fileDriver (int argc, char * argv [ ], sorts sortProcs [ ], int numAlgs,
+                int nSquaredCutoff) {
+    char * args [argc];
+    int num = modeArgs (argc, argv, args);
+    if (num < 3) {
+        printf ("usage:  %s file input-file [int32 | int64] [output-file]\n", argv[0]);
+        return 1;
+    }
+    if (num > 3 && strcmp (args[3], "int32") != 0 && strcmp (args[3], "int64") != 0) {
+        printf ("usage:  %s file input-file [int32 | int64] [output-file]\n", argv[0]);
+        return 1;
+    }
+    bool wide = num > 3 && strcmp (args[3], "int64") == 0;
+    size_t elemSize = wide ? sizeof(long long) : sizeof(int);
+    char * outName = (num > 4) ? args[4] : NULL;
+
+    #define numWide  3
+    typedSorts wideProcs [numWide] = {{"heap sort     ", "i64", sizeof(long long),
+                                       heapSort_i64_v, fillRandom_i64, checkAscending_i64_v},
+                                      {"merge sort    ", "i64", sizeof(long long),
+                                       mergeSort_i64_v, fillRandom_i64, checkAscending_i64_v},
+                                      {"introsort     ", "i64", sizeof(long long),
+                                       introsort_i64_v, fillRandom_i64, checkAscending_i64_v}};
+    int numRows = wide ? numWide : numAlgs;
+    char * shape = wide ? "int64 file" : "int32 file";
+
+    benchInit (1, 1, 2);
+    benchConf.trials = 3;
+    if (benchBegin (argc, argv) != 0)
+        return 1;
+    printf ("\n");
+
+    long long n = 0;
+    void * sorted = NULL;   // the data sorted by the last algorithm that ran
+    for (int alg = 0; alg < numRows; alg++) {
+        char * name = wide ? wideProcs[alg].name : sortProcs[alg].name;
+        benchResult result;
+        startResult (&result, name, "", shape, 0);
+        if (!benchMatches (result.algorithm, benchConf.algFilter))
+            continue;
+
+        void * data = mapIntFile (args[2], elemSize, &n);
+        if (data == NULL) {
+            benchEnd ();
+            return 1;
+        }
+        if (n > INT_MAX) {
+            printf ("%s: %lld elements is more than the sorts handle\n", args[2], n);
+            munmap (data, n * elemSize);
+            benchEnd ();
+            return 1;
+        }
+        result.n = n;
+        result.counted = !wide;   // the sorts of the main table count their operations
+        if (!wide && alg <= 3 && n > nSquaredCutoff) {
+            benchSkip (result.algorithm, shape, n);
+            munmap (data, n * elemSize);
+            continue;
+        }
+
+        fileTrial trial = {.name = args[2], .elemSize = elemSize, .data = data, .n = n,
+                           .wideProc = wide ? wideProcs[alg].sortProc : NULL,
+                           .intProc = wide ? NULL : sortProcs[alg].sortProc};
+        benchMeasure (remapFile, runFileSort, &trial, &result);
+        if (trial.data == NULL) {
+            if (sorted != NULL)
+                munmap (sorted, n * elemSize);
+            benchEnd ();
+            return 1;
+        }
+        data = trial.data;
+        result.check = wide ? checkAscending_i64_v (data, n) : checkAscending (data, n);
+        benchReport (&result);
+
+        if (sorted != NULL)
+            munmap (sorted, n * elemSize);
+        sorted = data;
+    }
+    benchEnd ();
+
+    int status = 0;
+    if (outName != NULL) {
+        if (sorted == NULL) {
+            printf ("no algorithm ran, so %s was not written\n", outName);
+            status = 1;
+        }
+        else if (saveIntFile (outName, sorted, n * elemSize) != 0)
+            status = 1;
+    }
+    if (sorted != NULL)
+        munmap (sorted, n * elemSize);
+    return status;
+}
+
+/* benchmark hooks reporting the memory traffic of sorts that record it */
+void resetMemoryPasses ( ) {
+    memoryPasses = 0;
+}
+
+void noteMemoryPasses (char note [ ], int length) {
+    if (memoryPasses > 0)
+        snprintf (note, length, "  %4d passes %8.1lf MB/pass", memoryPasses, passBytes / 1e6);
+}
+
+/** *******************************************************************************
+ * driver program for testing and timing sorting algorithms                       *
+ * run with the argument  typed  to time the typed sorts instead,                 *
+ *                        argsort  to time argsort on wide records,               *
+ *                        stable  to check which sorts are stable,                *
+ *                        external  to sort a file larger than memory,            *
+ *                        file  to time the sorts on the data of a file           *
+ * otherwise the arguments are options of the benchmark harness, in benchmark.h;  *
+ * every mode takes those options and prints and records its rows the same way    *
+ **********************************************************************************/
+int main (int argc, char * argv [ ]) {
+    if (argc > 1 && strcmp (argv[1], "typed") == 0)
+        return typedDriver (argc, argv);
+    if (argc > 1 && strcmp (argv[1], "argsort") == 0)
+        return argsortDriver (argc, argv);
+    if (argc > 1 && strcmp (argv[1], "stable") == 0)
+        return stableDriver (argc, argv);
+    if (argc > 1 && strcmp (argv[1], "external") == 0)
+        return externalDriver (argc, argv);
+
+    // declare array, indicating sorting algorithm names and function pointers
+    #define numAlgs  16
+    sorts sortProcs [numAlgs] = {{"selection sort", selectionSort},
+                                 {"insertion sort", insertionSort},
+                                 {"quicksort     ", quicksort   },
+                                 {"imp. quicksort", impQuicksort },
+                                 {"merge sort    ", mergeSort    },
+                                 {"heap sort     ", heapSort     },
+                                 {"par. quicksort", parQuicksort },
+                                 {"par. mergesort", parMergeSort },
+                                 {"radix sort    ", radixSort    },
+                                 {"am. flag sort ", americanFlagSort},
+                                 {"introsort     ", introsort    },
+                                 {"2-pivot qsort ", dualPivotQuicksort},
+                                 {"3-pivot qsort ", threePivotQuicksort},
+                                 {"powersort     ", powersort_i32},
+                                 {"tiled merge   ", tiledMergeSort},
+                                 {"d-ary heap    ", dAryHeapSort }};
+
+    //size variables 40960000
+    //nSquared 160000
+    int maxDataSetSize = 40960000;
+    int nSquaredCutoff = 160000; // do not print results from n^2 algorithms beyond this size data set
+
+    // sort the data of a file rather than generated data
+    if (argc > 1 && strcmp (argv[1], "file") == 0)
+        return fileDriver (argc, argv, sortProcs, numAlgs, nSquaredCutoff);
+
+    // randomize random number generator's seed
+    srand (time ((time_t *) 0) );
+    //srandom (time ((time_t *) 0) );
+
+    // time every algorithm with the shared benchmark harness
+    benchInit (10000, maxDataSetSize, 2);
+    benchConf.trials = 3;
+    for (int numSort = 0; numSort < numAlgs; numSort++) {
+        benchAlg * alg = benchAddSort (sortProcs[numSort].name, sortProcs[numSort].sortProc);
+        alg->counted = 1;
+        // n^2 sorts, and quicksorts exceeding the run-time stack on ordered arrays
+        if (numSort <= 3) {
+            benchLimit (alg, "ascending", nSquaredCutoff);
+            benchLimit (alg, "descending", nSquaredCutoff);
+        }
+        if (numSort <= 2)
+            benchLimit (alg, "random", nSquaredCutoff);
+    }
+    benchResetHook = resetMemoryPasses;
+    benchNoteHook = noteMemoryPasses;
+
+    return benchRun (argc, argv);
+}
@@ -4,8 +4,25 @@
 #include <stdio.h>
 #include <stdlib.h>   // for malloc, free
 #include <time.h>     // for time
+#include <limits.h>   // for INT_MAX
+
+#include "benchmark.h"      // shared timing harness
+#include "simd-partition.h" // SIMD partition kernels and dispatch
 
 #define hybridThreshold 10
+#ifndef hybridSimdPartition
+#define hybridSimdPartition 0  // 1 = hybrid quicksort partitions with the SIMD kernel
+                               // 0 = hybrid quicksort uses hybridPartition
+#endif
+#ifndef sortNetworkSize
+#define sortNetworkSize 64     // 8, 16, 32 or 64 = hybrid quicksort finishes segments of
+                               //    up to this size with a bitonic sorting network
+                               // 0 = segments up to hybridThreshold use insertion sort
+#endif
+#if sortNetworkSize != 0 && sortNetworkSize != 8 && sortNetworkSize != 16 \
+    && sortNetworkSize != 32 && sortNetworkSize != 64
+#error "sortNetworkSize must be 0, 8, 16, 32 or 64"
+#endif
 
 /* * * * * * * * * * * quicksort and helper functions * * * * * * * * * * */
 
@@ -161,6 +178,36 @@ void imprQuicksort (int a [ ], int n) {
     imprQuicksortHelper (a, n, 0, n-1);
 }
 
+/** *******************************************************************************
+ * procedure implements a vectorized partition with a random pivot                *
+ *    in brief: the random pivot is swapped to a[left], a[left+1..right] is split *
+ *              by the SIMD kernel into elements <= pivot and > pivot, then the   *
+ *              pivot is swapped to the boundary                                  *
+ * @param   a      the array containing the segment to be partitioned             *
+ * @param   size   the size of array a                                            *
+ * @param   left   the index of the first array element in the partition          *
+ * @param   right  the index of the last array element in the partition           *
+ * @post    elements between left and right are permuted, so that                 *
+ *             a[left], ..., a[mid-1] <= a[mid]                                   *
+ *             a[mid+1], ..., a[right] > a[mid]                                   *
+ * @post    elements outside left, ..., right are not changed                     *
+ * @returns  mid                                                                  *
+/ *********************************************************************************/
+int simdPartition (int a[ ], int size, int left, int right) {
+    int pivotIndex = left + (rand() % (right-left+1));
+    int temp = a[left];
+    a[left] = a[pivotIndex];
+    a[pivotIndex] = temp;
+
+    partitionKernel kernel = selectPartitionKernel (NULL);
+    int mid = kernel (a, left+1, right+1, a[left]) - 1;
+
+    temp = a[left];
+    a[left] = a[mid];
+    a[mid] = temp;
+    return mid;
+}
+
 /* * * * * * * * hybrid quicksort and helper functions * * * * * * * * * * */
 
 /** *******************************************************************************
@@ -240,6 +287,138 @@ void insertionSort(int a[ ], int low, int high) {
     }
 }
 
+/* * * * * * * * * * bitonic sorting networks for the base case * * * * * * * * */
+
+#if sortNetworkSize > 0
+
+/* a network sorts one block of sortNetworkSize elements in place */
+typedef void (*networkKernel) (int [ ]);
+
+/** *******************************************************************************
+ * scalar bitonic sorting network, used when the processor lacks AVX2             *
+ *    each stage compare-exchanges elements i and i+j, ascending when bit k of i  *
+ *    is 0 and descending otherwise; min and max compile to conditional moves     *
+ * @param  block  the sortNetworkSize elements to be sorted                       *
+ * @post  block is sorted in non-descending order                                 *
+ *********************************************************************************/
+void scalarNetworkKernel (int block [ ]) {
+    for (int k = 2; k <= sortNetworkSize; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2) {
+            for (int i = 0; i < sortNetworkSize; i++) {
+                if (i & j)
+                    continue;
+                int x = block[i];
+                int y = block[i + j];
+                int low = (x < y) ? x : y;
+                int high = (x < y) ? y : x;
+                int descending = (i & k) != 0;
+                block[i] = descending ? high : low;
+                block[i + j] = descending ? low : high;
+            }
+        }
+    }
+}
+
+#if haveX86Simd
+/** *******************************************************************************
+ * AVX2 bitonic sorting network, 8 compare-exchanges per instruction              *
+ *    stages with j >= 8 pair whole vectors; stages with j < 8 pair lanes of one  *
+ *    vector, taking min or max per lane with a blend, so no step branches on     *
+ *    the data                                                                    *
+ * @param  block  the sortNetworkSize elements to be sorted                       *
+ * @post  block is sorted in non-descending order                                 *
+ *********************************************************************************/
+__attribute__ ((target ("avx2")))
+void avx2NetworkKernel (int block [ ]) {
+    const __m256i lane = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i xorLane [5] = {_mm256_setzero_si256 (),
+                                 _mm256_setr_epi32 (1, 0, 3, 2, 5, 4, 7, 6),
+                                 _mm256_setr_epi32 (2, 3, 0, 1, 6, 7, 4, 5),
+                                 _mm256_setzero_si256 (),
+                                 _mm256_setr_epi32 (4, 5, 6, 7, 0, 1, 2, 3)};
+
+    for (int k = 2; k <= sortNetworkSize; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2) {
+            if (j >= 8) {
+                for (int i = 0; i < sortNetworkSize; i += 8) {
+                    if (i & j)
+                        continue;
+                    __m256i x = _mm256_loadu_si256 ((__m256i *) (block + i));
+                    __m256i y = _mm256_loadu_si256 ((__m256i *) (block + i + j));
+                    __m256i low = _mm256_min_epi32 (x, y);
+                    __m256i high = _mm256_max_epi32 (x, y);
+                    if (i & k) {
+                        __m256i temp = low;
+                        low = high;
+                        high = temp;
+                    }
+                    _mm256_storeu_si256 ((__m256i *) (block + i), low);
+                    _mm256_storeu_si256 ((__m256i *) (block + i + j), high);
+                }
+            } else {
+                const __m256i jVec = _mm256_set1_epi32 (j);
+                const __m256i kVec = _mm256_set1_epi32 (k);
+                for (int i = 0; i < sortNetworkSize; i += 8) {
+                    __m256i x = _mm256_loadu_si256 ((__m256i *) (block + i));
+                    __m256i y = _mm256_permutevar8x32_epi32 (x, xorLane[j]);
+                    __m256i low = _mm256_min_epi32 (x, y);
+                    __m256i high = _mm256_max_epi32 (x, y);
+                    // a lane keeps the max when it is the upper of its pair in an
+                    // ascending run, or the lower of its pair in a descending run
+                    __m256i index = _mm256_add_epi32 (_mm256_set1_epi32 (i), lane);
+                    __m256i upper = _mm256_cmpeq_epi32 (_mm256_and_si256 (index, jVec), jVec);
+                    __m256i descending = _mm256_cmpeq_epi32 (_mm256_and_si256 (index, kVec), kVec);
+                    __m256i takeHigh = _mm256_xor_si256 (upper, descending);
+                    _mm256_storeu_si256 ((__m256i *) (block + i),
+                                         _mm256_blendv_epi8 (low, high, takeHigh));
+                }
+            }
+        }
+    }
+}
+#endif
+
+/** *******************************************************************************
+ * choose the AVX2 network when the processor supports it, checked once           *
+ * @returns the network kernel                                                    *
+ *********************************************************************************/
+networkKernel selectNetworkKernel ( ) {
+    static networkKernel kernel = NULL;
+
+    if (kernel == NULL) {
+        kernel = scalarNetworkKernel;
+#if haveX86Simd
+        __builtin_cpu_init ();
+        if (__builtin_cpu_supports ("avx2"))
+            kernel = avx2NetworkKernel;
+#endif
+    }
+    return kernel;
+}
+
+/** *******************************************************************************
+ * sort a short segment with the sorting network                                  *
+ * the segment is copied into a block padded with INT_MAX, which sorts last       *
+ * @param  a  the array to be processed                                           *
+ * @param  left  the lower index for items to be processed                        *
+ * @param  right  the upper index for items to be processed                       *
+ * @pre   right - left < sortNetworkSize                                          *
+ * @post  sorts elements of a between left and right                              *
+ *********************************************************************************/
+void networkSort (int a [ ], int left, int right) {
+    int block [sortNetworkSize];
+    int len = right - left + 1;
+
+    for (int i = 0; i < len; i++)
+        block[i] = a[left + i];
+    for (int i = len; i < sortNetworkSize; i++)
+        block[i] = INT_MAX;
+    selectNetworkKernel () (block);
+    for (int i = 0; i < len; i++)
+        a[left + i] = block[i];
+}
+#endif
+
 /** *******************************************************************************
  * Hybrid Quicksort helper function                                               *
  * @param  a  the array to be processed                                           *
@@ -252,11 +431,21 @@ void hybridQuicksortHelper (int a [ ], int size, int left, int right) {
     if (left > right)
         return;
 
+#if sortNetworkSize > 0
+    // use the sorting network for segments that fit in one block
+    if ((right - left) < sortNetworkSize) {
+        networkSort(a, left, right);
+        return;
+    }
+#endif
+
     // use insertion sort for the defined threshold of array segments
     if ((right - left) <= hybridThreshold) {
-        insertionSort(a, left, right);
+        insertionSort(a, left, right + 1);
+        return;
     }
-    int mid = hybridPartition(a, size, left, right);
+    int mid = hybridSimdPartition ? simdPartition(a, size, left, right)
+                                  : hybridPartition(a, size, left, right);
     hybridQuicksortHelper(a, size, left, mid - 1);
     hybridQuicksortHelper(a, size, mid + 1, right);
 }
@@ -271,201 +460,382 @@ void hybridQuicksort (int a [ ], int n) {
     hybridQuicksortHelper (a, n, 0, n-1);
 }
 
-/* * * * * * * * * * * * procedures to check sorting correctness  * * * * * * * * * */
+/* * * * * * * * pattern-defeating quicksort and helper functions * * * * * * * */
+
+#define pdqInsertionThreshold 24   // ranges shorter than this use insertion sort
+#define pdqNintherThreshold  128   // ranges longer than this use the ninther pivot
+#define pdqPartialLimit        8   // moves allowed before partial insertion sort gives up
+#define pdqBlockSize          64   // elements examined per block in block partition
 
 /** *******************************************************************************
- * check all array elements have values 0, 2, 4, . . ., 2(n-1)                    *
- * @param  a  the array to be sorted                                              *
- * @param  n  the size of the array                                               *
- * returns  "ok" if array contains required elements; "NO" if not                 *
+ * swap function to interchange two array elements                                *
+ * @param   a  the array                                                          *
+ * @param   i  the index of one element                                           *
+ * @param   j  the index of the other element                                     *
+ * @post    a[i] and a[j] are exchanged                                           *
+ *********************************************************************************/
+void pdqSwap (int a[ ], int i, int j) {
+    int temp = a[i];
+    a[i] = a[j];
+    a[j] = temp;
+}
+
+/** *******************************************************************************
+ * sort three array elements in place                                             *
+ * @param   a  the array                                                          *
+ * @param   i, j, k  indices of the elements                                      *
+ * @post    a[i] <= a[j] <= a[k]                                                  *
  *********************************************************************************/
+void pdqSort3 (int a[ ], int i, int j, int k) {
+    if (a[j] < a[i]) pdqSwap (a, i, j);
+    if (a[k] < a[j]) pdqSwap (a, j, k);
+    if (a[j] < a[i]) pdqSwap (a, i, j);
+}
 
-char * checkAscValues (int a [ ], int n) {
-    for (int i = 0; i < n; i++) {
-        if (a[i] != 2*i) {
-            printf ("%4d %4d", i, a[i]);
-            return "NO";
+/** *******************************************************************************
+ * insertion sort that gives up once more than pdqPartialLimit elements moved     *
+ * @param  a      the array to be processed                                       *
+ * @param  begin  the index of the first element to be processed                 *
+ * @param  end    one past the index of the last element to be processed          *
+ * @returns  1 if a[begin..end-1] is now sorted; 0 if the sort was abandoned      *
+ *********************************************************************************/
+int pdqPartialInsertionSort (int a[ ], int begin, int end) {
+    int limit = 0;
+    for (int cur = begin + 1; cur < end; cur++) {
+        if (a[cur] < a[cur - 1]) {
+            int temp = a[cur];
+            int j = cur;
+            do {
+                a[j] = a[j - 1];
+                j--;
+            } while (j > begin && temp < a[j - 1]);
+            a[j] = temp;
+            limit += cur - j;
         }
+        if (limit > pdqPartialLimit)
+            return 0;
     }
-    return "ok";
+    return 1;
 }
 
 /** *******************************************************************************
- * check all array elements are in non-descending order                           *
- * @param  a  the array to be sorted                                              *
- * @param  n  the size of the array                                               *
- * returns  "ok" if array elements in non-descending order; "NO" otherwise        *
+ * move an element down a max-heap until its children are no larger              *
+ * @param  h     the heap                                                         *
+ * @param  hole  index of the element to be moved down                            *
+ * @param  size  the number of elements in the heap                               *
+ * @post  the subtree rooted at hole is a heap                                    *
  *********************************************************************************/
-
-char * checkAscending (int a [ ], int n) {
-    for (int i = 0; i < n-1; i++) {
-        if (a[i] > a[i+1])
-            return "NO";
+void pdqSiftDown (int h[ ], int hole, int size) {
+    int item = h[hole];
+    int child = 2 * hole + 1;
+    while (child < size) {
+        if (child + 1 < size && h[child] < h[child + 1])
+            child++;
+        if (h[child] <= item)
+            break;
+        h[hole] = h[child];
+        hole = child;
+        child = 2 * hole + 1;
     }
-    return "ok";
+    h[hole] = item;
 }
 
 /** *******************************************************************************
- * driver program for testing and timing quicksort algorithms                     *
-  ********************************************************************************/
-int main ( ) {
-    // set rand() seed
-    srand(time ((time_t *) 0));
-
-    // print headings
-    printf ("                    Data Set                   Times\n");
-    printf ("Algorithm             Size     Ascending Order   Random Order  Descending Order\n");
-
-    int size;
-    for (size = 4000; size <= 5120000; size *= 2) {
-        // create control data set arrays
-        int * asc = (int *) malloc (size * sizeof(int));   //array with ascending data
-        int * ran = (int *) malloc (size * sizeof(int));   //array with random data
-        int * des = (int *) malloc (size * sizeof(int));   // array with descending data
-
-        int i;
-        for (i = 0; i< size; i++) {
-            asc[i] = 2*i;
-            ran[i] = rand();
-            des[i] = 2*(size - i - 1);
-        }
+ * heap sort of a range, the fallback once too many partitions were unbalanced    *
+ * @param  a      the array to be processed                                       *
+ * @param  begin  the index of the first element to be processed                  *
+ * @param  end    one past the index of the last element to be processed          *
+ * @post  sorts elements of a between begin and end-1                             *
+ *********************************************************************************/
+void pdqHeapSort (int a[ ], int begin, int end) {
+    int * h = a + begin;
+    int n = end - begin;
+
+    for (int i = n / 2 - 1; i >= 0; i--)
+        pdqSiftDown (h, i, n);
+    for (int last = n - 1; last > 0; last--) {
+        pdqSwap (h, 0, last);
+        pdqSiftDown (h, 0, last);
+    }
+}
 
-        // timing variables
-        clock_t start_time, end_time;
-        double elapsed_time;
+/** *******************************************************************************
+ * partition around the pivot a[begin], equal elements going to the left side    *
+ * used when the pivot equals the element just before the range, so the range    *
+ * holds many copies of it; elements equal to the pivot are then done            *
+ * @param  a      the array containing the segment to be partitioned              *
+ * @param  begin  the index of the pivot, the first element of the segment        *
+ * @param  end    one past the index of the last element of the segment           *
+ * @post   a[begin..mid-1] <= a[mid] < a[mid+1..end-1]                            *
+ * @returns  mid                                                                  *
+ *********************************************************************************/
+int pdqPartitionLeft (int a[ ], int begin, int end) {
+    int pivot = a[begin];
+    int first = begin;
+    int last = end;
+
+    while (pivot < a[--last]);
+    if (last + 1 == end)
+        while (first < last && !(pivot < a[++first]));
+    else
+        while (!(pivot < a[++first]));
+
+    while (first < last) {
+        pdqSwap (a, first, last);
+        while (pivot < a[--last]);
+        while (!(pivot < a[++first]));
+    }
 
-        // copy to test arrays
-        int * tempAsc = (int *) malloc (size * sizeof(int));
-        int * tempRan = (int *) malloc (size * sizeof(int));
-        int * tempDes = (int *) malloc (size * sizeof(int));
+    a[begin] = a[last];
+    a[last] = pivot;
+    return last;
+}
 
-        /* * * * * * * * * test of basic quicksort * * * * * * * * * * * * * * */
-        for (i = 0; i< size; i++) {
-            tempAsc[i] = asc[i];
-            tempRan[i] = ran[i];
-            tempDes[i] = des[i];
+/** *******************************************************************************
+ * exchange the misplaced elements recorded by pdqPartitionRight                  *
+ * @param  a         the array being partitioned                                  *
+ * @param  lBase     index the left offsets are relative to                       *
+ * @param  rBase     index the right offsets are measured back from               *
+ * @param  offsetsL  offsets of elements >= pivot on the left                     *
+ * @param  offsetsR  offsets of elements < pivot on the right                     *
+ * @param  num       number of pairs to exchange                                  *
+ * @param  useSwaps  1 to exchange pairwise, needed to keep descending input O(n) *
+ *                   0 to rotate all elements in one cycle, with fewer moves      *
+ *********************************************************************************/
+void pdqSwapOffsets (int a[ ], int lBase, int rBase, unsigned char offsetsL[ ],
+                     unsigned char offsetsR[ ], int num, int useSwaps) {
+    if (useSwaps) {
+        for (int i = 0; i < num; i++)
+            pdqSwap (a, lBase + offsetsL[i], rBase - offsetsR[i]);
+    } else if (num > 0) {
+        int l = lBase + offsetsL[0];
+        int r = rBase - offsetsR[0];
+        int temp = a[l];
+        a[l] = a[r];
+        for (int i = 1; i < num; i++) {
+            l = lBase + offsetsL[i];
+            a[r] = a[l];
+            r = rBase - offsetsR[i];
+            a[l] = a[r];
         }
+        a[r] = temp;
+    }
+}
 
-        // timing for basic quicksort
-        printf("basic quicksort    %7d", size);
-
-        if (size < 40000) {
-            // ascending data
-            start_time = clock();
-            basicQuicksort(tempAsc, size);
-            end_time = clock();
-            elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-            printf("%13.1lf", elapsed_time);
-            printf("  %2s", checkAscValues(tempAsc, size));
+/** *******************************************************************************
+ * block partition around the pivot a[begin], equal elements going right          *
+ * following BlockQuicksort (Edelkamp and Weiss), the comparisons only record     *
+ * offsets of misplaced elements, without branching, and the recorded elements    *
+ * are exchanged afterwards in bulk                                               *
+ * @param  a      the array containing the segment to be partitioned              *
+ * @param  begin  the index of the pivot, the first element of the segment        *
+ * @param  end    one past the index of the last element of the segment           *
+ * @param  alreadyPartitioned  set to 1 if no element had to be moved             *
+ * @pre    some element of a[begin+1..end-1] is >= the pivot (median of 3)        *
+ * @post   a[begin..mid-1] < a[mid] <= a[mid+1..end-1]                            *
+ * @returns  mid                                                                  *
+ *********************************************************************************/
+int pdqPartitionRight (int a[ ], int begin, int end, int * alreadyPartitioned) {
+    int pivot = a[begin];
+    int first = begin;
+    int last = end;
+
+    // find the first element >= pivot and the last element < pivot
+    while (a[++first] < pivot);
+    if (first - 1 == begin)
+        while (first < last && !(a[--last] < pivot));
+    else
+        while (!(a[--last] < pivot));
+
+    *alreadyPartitioned = first >= last;
+    if (!*alreadyPartitioned) {
+        pdqSwap (a, first, last);
+        first++;
+
+        unsigned char offsetsL [pdqBlockSize];
+        unsigned char offsetsR [pdqBlockSize];
+        int lBase = first;
+        int rBase = last;
+        int numL = 0, numR = 0, startL = 0, startR = 0;
+
+        while (first < last) {
+            // refill whichever offset block is empty from the unknown elements
+            int numUnknown = last - first;
+            int leftSplit = (numL == 0) ? ((numR == 0) ? numUnknown / 2 : numUnknown) : 0;
+            int rightSplit = (numR == 0) ? (numUnknown - leftSplit) : 0;
+
+            if (leftSplit > pdqBlockSize)
+                leftSplit = pdqBlockSize;
+            for (int i = 0; i < leftSplit; i++) {
+                offsetsL[numL] = (unsigned char) i;
+                numL += !(a[first] < pivot);
+                first++;
+            }
+
+            if (rightSplit > pdqBlockSize)
+                rightSplit = pdqBlockSize;
+            for (int i = 0; i < rightSplit; ) {
+                offsetsR[numR] = (unsigned char) ++i;
+                numR += a[--last] < pivot;
+            }
+
+            int num = (numL < numR) ? numL : numR;
+            pdqSwapOffsets (a, lBase, rBase, offsetsL + startL, offsetsR + startR,
+                            num, numL == numR);
+            numL -= num;
+            numR -= num;
+            startL += num;
+            startR += num;
+
+            if (numL == 0) {
+                startL = 0;
+                lBase = first;
+            }
+            if (numR == 0) {
+                startR = 0;
+                rBase = last;
+            }
         }
-        else {
-            printf("\t    ----   ");
+
+        // elements left in one block go to the far side of the boundary
+        if (numL) {
+            while (numL--)
+                pdqSwap (a, lBase + offsetsL[startL + numL], --last);
+            first = last;
         }
-        // tandem data
-        start_time = clock ();
-        basicQuicksort (tempRan, size);
-        end_time = clock();
-        elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-        printf ("%11.1lf", elapsed_time);
-        printf ("  %2s", checkAscending (tempRan, size));
-
-        if (size <= 32000) {
-            // descending data
-            start_time = clock();
-            basicQuicksort(tempDes, size);
-            end_time = clock();
-            elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-            printf("%14.1lf", elapsed_time);
-            printf("  %2s", checkAscValues(tempDes, size));
-            printf("\n");
+        if (numR) {
+            while (numR--) {
+                pdqSwap (a, rBase - offsetsR[startR + numR], first);
+                first++;
+            }
+            last = first;
         }
-        else {
-            printf("\t     ----   \n");
+    }
+
+    // put the pivot in its place
+    int mid = first - 1;
+    a[begin] = a[mid];
+    a[mid] = pivot;
+    return mid;
+}
+
+/** *******************************************************************************
+ * pattern-defeating quicksort helper function (after Orson Peters' pdqsort)      *
+ * @param  a           the array to be processed                                  *
+ * @param  begin       the index of the first element to be processed             *
+ * @param  end         one past the index of the last element to be processed     *
+ * @param  badAllowed  unbalanced partitions allowed before using heap sort       *
+ * @param  leftmost    1 if no element precedes the range, 0 if a[begin-1] is     *
+ *                     a previous pivot, no larger than any element of the range  *
+ * @post  sorts elements of a between begin and end-1                             *
+ *********************************************************************************/
+void pdqsortLoop (int a[ ], int begin, int end, int badAllowed, int leftmost) {
+    while (1) {
+        int size = end - begin;
+
+        if (size < pdqInsertionThreshold) {
+            insertionSort (a, begin, end);
+            return;
         }
 
+        // pivot is the median of 3, or Tukey's ninther for long ranges, moved to a[begin]
+        int s2 = size / 2;
+        if (size > pdqNintherThreshold) {
+            pdqSort3 (a, begin, begin + s2, end - 1);
+            pdqSort3 (a, begin + 1, begin + (s2 - 1), end - 2);
+            pdqSort3 (a, begin + 2, begin + (s2 + 1), end - 3);
+            pdqSort3 (a, begin + (s2 - 1), begin + s2, begin + (s2 + 1));
+            pdqSwap (a, begin, begin + s2);
+        } else {
+            pdqSort3 (a, begin + s2, begin, end - 1);
+        }
 
-        /* * * * * * * * * test of improved quicksort * * * * * * * * * * * * * * */
-        for (i = 0; i< size; i++) {
-            tempAsc[i] = asc[i];
-            tempRan[i] = ran[i];
-            tempDes[i] = des[i];
+        // a pivot equal to the previous pivot means many equal elements:
+        // put them all on the left, where they need no further sorting
+        if (!leftmost && !(a[begin - 1] < a[begin])) {
+            begin = pdqPartitionLeft (a, begin, end) + 1;
+            continue;
         }
 
-        // timing for improved quicksort
-        printf ("improved quicksort %7d", size);
-
-        // ascending data
-        start_time = clock ();
-        imprQuicksort (tempAsc, size);
-        end_time = clock();
-        elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-        printf ("%13.1lf", elapsed_time);
-        printf ("  %2s", checkAscValues (tempAsc, size));
-
-        // random data
-        start_time = clock ();
-        imprQuicksort (tempRan, size);
-        end_time = clock();
-        elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-        printf ("%11.1lf", elapsed_time);
-        printf ("  %2s", checkAscending (tempRan, size));
-
-        // descending data
-        start_time = clock ();
-        imprQuicksort (tempDes, size);
-        end_time = clock();
-        elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-        printf ("%14.1lf", elapsed_time);
-        printf ("  %2s", checkAscValues (tempDes, size));
-        printf ("\n");
-
-
-        /* * * * * * * * * test of hybrid quicksort * * * * * * * * * * * * * * */
-        for (i = 0; i< size; i++) {
-            tempAsc[i] = asc[i];
-            tempRan[i] = ran[i];
-            tempDes[i] = des[i];
+        int alreadyPartitioned;
+        int mid = pdqPartitionRight (a, begin, end, &alreadyPartitioned);
+
+        int lSize = mid - begin;
+        int rSize = end - (mid + 1);
+        if (lSize < size / 8 || rSize < size / 8) {
+            // unbalanced: give up on quicksort after too many, otherwise
+            // break up patterns by swapping a few elements on each side
+            if (--badAllowed == 0) {
+                pdqHeapSort (a, begin, end);
+                return;
+            }
+
+            if (lSize >= pdqInsertionThreshold) {
+                pdqSwap (a, begin, begin + lSize / 4);
+                pdqSwap (a, mid - 1, mid - lSize / 4);
+                if (lSize > pdqNintherThreshold) {
+                    pdqSwap (a, begin + 1, begin + (lSize / 4 + 1));
+                    pdqSwap (a, begin + 2, begin + (lSize / 4 + 2));
+                    pdqSwap (a, mid - 2, mid - (lSize / 4 + 1));
+                    pdqSwap (a, mid - 3, mid - (lSize / 4 + 2));
+                }
+            }
+            if (rSize >= pdqInsertionThreshold) {
+                pdqSwap (a, mid + 1, mid + (1 + rSize / 4));
+                pdqSwap (a, end - 1, end - rSize / 4);
+                if (rSize > pdqNintherThreshold) {
+                    pdqSwap (a, mid + 2, mid + (2 + rSize / 4));
+                    pdqSwap (a, mid + 3, mid + (3 + rSize / 4));
+                    pdqSwap (a, end - 2, end - (1 + rSize / 4));
+                    pdqSwap (a, end - 3, end - (2 + rSize / 4));
+                }
+            }
+        } else if (alreadyPartitioned
+                   && pdqPartialInsertionSort (a, begin, mid)
+                   && pdqPartialInsertionSort (a, mid + 1, end)) {
+            // range was already partitioned and both sides nearly sorted
+            return;
         }
 
-        // timing for hybrid quicksort
-        printf ("hybrid quicksort   %7d", size);
-
-        // ascending data
-        start_time = clock ();
-        hybridQuicksort (tempAsc, size);
-        end_time = clock();
-        elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-        printf ("%13.1lf", elapsed_time);
-        printf ("  %2s", checkAscValues (tempAsc, size));
-
-        // random data
-        start_time = clock ();
-        hybridQuicksort (tempRan, size);
-        end_time = clock();
-        elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-        printf ("%11.1lf", elapsed_time);
-        printf ("  %2s", checkAscending (tempRan, size));
-
-        // descending data
-        start_time = clock ();
-        hybridQuicksort (tempDes, size);
-        end_time = clock();
-        elapsed_time = (end_time - start_time) / (double) CLOCKS_PER_SEC;
-        printf ("%14.1lf", elapsed_time);
-        printf ("  %2s", checkAscValues (tempDes, size));
-        printf ("\n\n");
-
-        // clean up copies of test arrays
-        free (tempAsc);
-        free (tempRan);
-        free (tempDes);
-
-        // clean up original test arrays
-        free (asc);
-        free (ran);
-        free (des);
-
-    } // end of loop for testing procedures with different array sizes
-
-    return 0;
-}
\ No newline at end of file
+        // sort the left side recursively and the right side by looping
+        pdqsortLoop (a, begin, mid, badAllowed, leftmost);
+        begin = mid + 1;
+        leftmost = 0;
+    }
+}
+
+/** *******************************************************************************
+ * pattern-defeating quicksort, main function                                     *
+ * sorted and reverse sorted inputs finish in linear time; after log2(n)          *
+ * unbalanced partitions a range is heap sorted, bounding the worst case          *
+ * @param  a  the array to be sorted                                              *
+ * @param  n  the size of the array                                               *
+ * @post  the first n elements of a are sorted in non-descending order            *
+  ********************************************************************************/
+void pdqsort (int a [ ], int n) {
+    int log2n = 0;
+    for (int m = n; m > 1; m /= 2)
+        log2n++;
+    if (n > 1)
+        pdqsortLoop (a, 0, n, log2n, 1);
+}
+
+/** *******************************************************************************
+ * driver program for testing and timing quicksort algorithms                     *
+  ********************************************************************************/
+int main (int argc, char * argv [ ]) {
+    // set rand() seed
+    srand(time ((time_t *) 0));
+
+    // time every algorithm with the shared benchmark harness
+    benchInit (4000, 5120000, 2);
+    benchAlg * basic = benchAddSort ("basic quicksort", basicQuicksort);
+    // basic quicksort exceeds the run-time stack on large ordered arrays
+    benchLimit (basic, "ascending", 32000);
+    benchLimit (basic, "descending", 32000);
+    benchAddSort ("improved quicksort", imprQuicksort);
+    benchAddSort ("hybrid quicksort", hybridQuicksort);
+    benchAddSort ("pdq quicksort", pdqsort);
+
+    return benchRun (argc, argv);
+}